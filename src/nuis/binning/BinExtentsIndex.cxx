@@ -0,0 +1,208 @@
+#include "nuis/binning/BinExtentsIndex.h"
+
+#include "nuis/binning/exceptions.h"
+#include "nuis/binning/utility.h"
+
+#include "nuis/log.txx"
+
+#include "fmt/ranges.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace nuis {
+
+namespace {
+
+// the cell along an axis that contains x, or npos if x is outside of the
+// outermost edges or is NaN
+size_t find_cell(std::vector<double> const &edges, double x) {
+  auto upper = std::upper_bound(edges.begin(), edges.end(), x);
+  if ((upper == edges.begin()) || (upper == edges.end())) {
+    return Binning::npos;
+  }
+  return size_t(std::distance(edges.begin(), upper) - 1);
+}
+
+// the range of cells along an axis covered by an extent, whose edges are
+// always present in the edges list
+std::pair<size_t, size_t> covered_cells(std::vector<double> const &edges,
+                                        SingleExtent const &ext) {
+  auto low = std::lower_bound(edges.begin(), edges.end(), ext.low);
+  auto high = std::lower_bound(edges.begin(), edges.end(), ext.high);
+  return {size_t(std::distance(edges.begin(), low)),
+          size_t(std::distance(edges.begin(), high))};
+}
+
+} // namespace
+
+BinExtentsIndex::BinExtentsIndex(std::vector<Binning::BinExtents> const &bi,
+                                 size_t max_cells)
+    : bins(bi), nax(0), slab_axis(0) {
+
+  if (!bins.size()) {
+    log_critical("[BinExtentsIndex]: Passed empty bins.");
+    throw EmptyBinning();
+  }
+
+  nax = bins.front().size();
+
+  for (auto const &bin : bins) {
+    if (bin.size() != nax) {
+      log_critical("[BinExtentsIndex]: Passed bins with {} and {} axes.", nax,
+                   bin.size());
+      throw MismatchedAxisCount();
+    }
+  }
+
+  edges.resize(nax);
+  for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+    auto &ax_edges = edges[ax_it];
+    ax_edges.reserve(2 * bins.size());
+    for (auto const &bin : bins) {
+      ax_edges.push_back(bin[ax_it].low);
+      ax_edges.push_back(bin[ax_it].high);
+    }
+    std::sort(ax_edges.begin(), ax_edges.end());
+    ax_edges.erase(std::unique(ax_edges.begin(), ax_edges.end()),
+                   ax_edges.end());
+  }
+
+  // count the grid cells, giving up as soon as there are too many
+  size_t ncells = 1;
+  strides.resize(nax);
+  for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+    strides[ax_it] = ncells;
+    size_t ax_ncells = edges[ax_it].size() - 1;
+    if (ax_ncells && (ncells > (max_cells / ax_ncells))) {
+      ncells = max_cells + 1;
+      break;
+    }
+    ncells *= ax_ncells;
+  }
+
+  std::vector<std::pair<size_t, size_t>> covered(nax);
+
+  if (ncells && (ncells <= max_cells)) {
+    cells.assign(ncells, Binning::npos);
+
+    for (size_t bi_it = 0; bi_it < bins.size(); ++bi_it) {
+      bool empty = false;
+      for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+        covered[ax_it] = covered_cells(edges[ax_it], bins[bi_it][ax_it]);
+        empty = empty || (covered[ax_it].first >= covered[ax_it].second);
+      }
+      if (empty) {
+        continue;
+      }
+
+      // step through every covered cell, incrementing the lowest axis first
+      std::vector<size_t> cell(nax);
+      for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+        cell[ax_it] = covered[ax_it].first;
+      }
+      while (true) {
+        size_t cell_it = 0;
+        for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+          cell_it += cell[ax_it] * strides[ax_it];
+        }
+        if (cells[cell_it] == Binning::npos) {
+          cells[cell_it] = Binning::index_t(bi_it);
+        }
+
+        size_t ax_it = 0;
+        for (; ax_it < nax; ++ax_it) {
+          if (++cell[ax_it] < covered[ax_it].second) {
+            break;
+          }
+          cell[ax_it] = covered[ax_it].first;
+        }
+        if (ax_it == nax) {
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  log_debug("[BinExtentsIndex]: A grid over {} bins would need more than {} "
+            "cells, using slab lists instead.",
+            bins.size(), max_cells);
+
+  for (size_t ax_it = 1; ax_it < nax; ++ax_it) {
+    if (edges[ax_it].size() > edges[slab_axis].size()) {
+      slab_axis = ax_it;
+    }
+  }
+
+  slabs.resize(edges[slab_axis].size() - 1);
+  for (size_t bi_it = 0; bi_it < bins.size(); ++bi_it) {
+    auto slab_range = covered_cells(edges[slab_axis], bins[bi_it][slab_axis]);
+    for (size_t slab_it = slab_range.first; slab_it < slab_range.second;
+         ++slab_it) {
+      slabs[slab_it].push_back(Binning::index_t(bi_it));
+    }
+  }
+}
+
+template <typename Projection>
+Binning::index_t BinExtentsIndex::find(Projection const &x) const {
+
+  if (is_grid()) {
+    size_t cell_it = 0;
+    for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+      size_t cell = find_cell(edges[ax_it], x(ax_it));
+      if (cell == Binning::npos) {
+        return Binning::npos;
+      }
+      cell_it += cell * strides[ax_it];
+    }
+    return cells[cell_it];
+  }
+
+  size_t slab = find_cell(edges[slab_axis], x(slab_axis));
+  if (slab == Binning::npos) {
+    return Binning::npos;
+  }
+
+  for (Binning::index_t bi_it : slabs[slab]) {
+    bool found_bin = true;
+    for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
+      if (!bins[bi_it][ax_it].contains(x(ax_it))) {
+        found_bin = false;
+        break;
+      }
+    }
+    if (found_bin) {
+      return bi_it;
+    }
+  }
+
+  return Binning::npos;
+}
+
+Binning::index_t
+BinExtentsIndex::operator()(std::vector<double> const &x) const {
+  if (x.size() < nax) {
+    log_critical("[BinExtentsIndex]: projections passed in: {} is "
+                 "smaller than the number of axes in a bin: {}",
+                 x, nax);
+    throw MismatchedAxisCount();
+  }
+  return find([&](size_t ax_it) { return x[ax_it]; });
+}
+
+void BinExtentsIndex::operator()(Binning::ProjectionsRef const &x,
+                                 Binning::BinIndices &bins_out) const {
+  if (size_t(x.cols()) < nax) {
+    log_critical("[BinExtentsIndex]: {} projection columns passed in is "
+                 "smaller than the number of axes in a bin: {}",
+                 x.cols(), nax);
+    throw MismatchedAxisCount();
+  }
+  for (Eigen::Index row_it = 0; row_it < x.rows(); ++row_it) {
+    bins_out[row_it] = find([&](size_t ax_it) { return x(row_it, ax_it); });
+  }
+}
+
+} // namespace nuis
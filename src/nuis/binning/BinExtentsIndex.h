@@ -0,0 +1,56 @@
+#pragma once
+
+#include "nuis/binning/Binning.h"
+
+#include <memory>
+#include <vector>
+
+namespace nuis {
+
+// A search structure over an arbitrary list of axis-aligned bins. The sorted,
+// unique bin edges along each axis split the space into a grid of cells that
+// each lie either wholly inside or wholly outside of every bin, so a lookup is
+// one binary search per axis followed by a table read. If the grid would have
+// more than max_cells cells, only the axis with the most edges is gridded and
+// each of its slabs keeps a list of the bins that cross it.
+//
+// Lookups return the lowest index of the bins that contain the point, which
+// matches a linear scan over the bins even if they overlap. An index holds no
+// mutable state, so many threads can use it at once.
+struct BinExtentsIndex : public nuis_named_log("Binning") {
+
+  static constexpr size_t default_max_cells = 1 << 20;
+
+  BinExtentsIndex(std::vector<Binning::BinExtents> const &bins,
+                  size_t max_cells = default_max_cells);
+
+  Binning::index_t operator()(std::vector<double> const &x) const;
+  void operator()(Binning::ProjectionsRef const &x,
+                  Binning::BinIndices &bins_out) const;
+
+  size_t number_of_axes() const { return nax; }
+  // false if the index fell back to slab lists
+  bool is_grid() const { return !cells.empty(); }
+
+private:
+  template <typename Projection>
+  Binning::index_t find(Projection const &x) const;
+
+  std::vector<Binning::BinExtents> bins;
+  size_t nax;
+
+  // the sorted, unique bin edges along each axis
+  std::vector<std::vector<double>> edges;
+
+  // grid mode: the bin covering each cell, strided by axis
+  std::vector<size_t> strides;
+  std::vector<Binning::index_t> cells;
+
+  // slab mode: the bins crossing each cell along slab_axis
+  size_t slab_axis;
+  std::vector<std::vector<Binning::index_t>> slabs;
+};
+
+using BinExtentsIndexPtr = std::shared_ptr<BinExtentsIndex const>;
+
+} // namespace nuis
@@ -14,9 +14,46 @@ Binning::index_t Binning::find_bin(std::vector<double> const &x) const {
   return binning_function(x);
 }
 Binning::index_t Binning::find_bin(double x) const {
-  static std::vector<double> vect = {0};
-  vect[0] = x;
-  return binning_function(vect);
+  if (axis_kernel.kind != AxisKernel::kind_t::none) {
+    return axis_kernel(x);
+  }
+  return binning_function(std::vector<double>{x});
+}
+
+Binning::index_t Binning::AxisKernel::reject(double x) const {
+  if ((kind == kind_t::logarithmic) && std::isnormal(x)) {
+    log_info("[{}.binning_function] was passed an unloggable number = {}. "
+             "Returning npos. Compile with CMAKE_BUILD_TYPE=Debug to make this "
+             "an exception.",
+             name, x);
+  } else {
+    log_warn("[{}.binning_function] was passed an abnornmal number = {}. "
+             "Returning npos. Compile with CMAKE_BUILD_TYPE=Debug to make this "
+             "an exception.",
+             name, x);
+  }
+#ifndef NUIS_NDEBUG
+  throw UnbinnableNumber();
+#endif
+  return npos;
+}
+
+Binning::BinIndices
+Binning::find_bins(ProjectionsRef const &projections) const {
+  BinIndices rtn(projections.rows());
+  if (batch_binning_function) {
+    batch_binning_function(projections, rtn);
+    return rtn;
+  }
+
+  std::vector<double> x(projections.cols());
+  for (Eigen::Index i = 0; i < projections.rows(); ++i) {
+    for (Eigen::Index j = 0; j < projections.cols(); ++j) {
+      x[j] = projections(i, j);
+    }
+    rtn[i] = binning_function(x);
+  }
+  return rtn;
 }
 
 Eigen::ArrayXd Binning::bin_sizes() const {
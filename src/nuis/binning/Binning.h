@@ -9,6 +9,8 @@
 
 #include "Eigen/Dense"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <functional>
 #include <iostream>
@@ -27,10 +29,45 @@ struct Binning : public nuis_named_log("Binning") {
   //--- types
   using index_t = uint32_t;
   using BinExtents = std::vector<SingleExtent>;
+  using BinIndices = Eigen::Array<index_t, Eigen::Dynamic, 1>;
+  // one row per entry and one column per axis
+  using ProjectionsRef = Eigen::Ref<Eigen::ArrayXXd const>;
 
   //--- constants
   static constexpr index_t npos = std::numeric_limits<index_t>::max();
 
+  // A non-type-erased bin lookup for the single-axis lin_space, log10_space,
+  // ln_space, and contiguous binnings, used by their binning functions and
+  // called directly by find_bin(double). It holds no mutable state, so many
+  // threads can use it at once.
+  struct AxisKernel {
+    enum class kind_t { none, uniform, logarithmic, edges };
+    kind_t kind = kind_t::none;
+
+    // the binning extent
+    double low = 0, high = 0;
+    index_t nbins = 0;
+    // the uniform bin width, in log space for logarithmic binnings
+    double width = 0;
+    // logarithmic only: 0 for natural logarithms, and log(low)
+    uint log_base = 0;
+    double log_low = 0;
+    // logarithmic and edges only: every bin edge
+    std::vector<double> edges;
+    // used to identify the binning in warnings
+    std::string name;
+
+    index_t operator()(double x) const;
+
+    // Corrects a bin estimated in log space, which may be off by one through
+    // rounding in the logarithm, to the bin whose edges contain x.
+    index_t snap_to_edges(double x, double estimate) const;
+
+  private:
+    // warns about, and in debug builds throws for, abnormal or unloggable x
+    index_t reject(double x) const;
+  };
+
   //--- data members
   std::vector<std::string> axis_labels;
 
@@ -39,10 +76,22 @@ struct Binning : public nuis_named_log("Binning") {
 
   std::function<index_t(std::vector<double> const &)> binning_function;
 
+  // set by the single-axis factories, see AxisKernel
+  AxisKernel axis_kernel;
+
+  // Optional vectorized equivalent of binning_function that bins every row of
+  // the projections at once and writes the bin indices to the second argument.
+  // If unset, find_bins calls binning_function for each row.
+  std::function<void(ProjectionsRef const &, BinIndices &)>
+      batch_binning_function;
+
   // convenience functor-like overloads for calling Binning::binning_function
   index_t find_bin(std::vector<double> const &) const;
   index_t find_bin(double) const;
 
+  // Bins every row of projections, which must have a column for each axis.
+  BinIndices find_bins(ProjectionsRef const &projections) const;
+
   //--- member functions
 
   // Get the size for every bin.
@@ -69,17 +118,69 @@ struct Binning : public nuis_named_log("Binning") {
   static BinningPtr contiguous(std::vector<double> const &edges,
                                std::string const &label = "");
 
-  // extents must be unique and non-overlapping
+  // extents must be unique and non-overlapping, bins are looked up with a
+  // BinExtentsIndex
   static BinningPtr from_extents(std::vector<BinExtents> extents,
                                  std::vector<std::string> const &labels = {});
 
-  // like from_extents but with no heuristic optimisation
+  // like from_extents but searches the bins linearly
   static BinningPtr brute_force(std::vector<BinExtents> extents,
                                 std::vector<std::string> const &labels = {});
 
   static BinningPtr product(std::vector<BinningPtr> ops);
 };
 
+inline Binning::index_t Binning::AxisKernel::operator()(double x) const {
+  switch (kind) {
+  case kind_t::uniform: {
+    if ((x != 0) && !std::isnormal(x)) {
+      return reject(x);
+    }
+    if ((x < low) || (x >= high)) {
+      return npos;
+    }
+    // guard against rounding just below the upper edge
+    return std::min(index_t(std::floor((x - low) / width)), index_t(nbins - 1));
+  }
+  case kind_t::logarithmic: {
+    if (!std::isnormal(x) || (x < 0)) {
+      return reject(x);
+    }
+    if ((x < low) || (x >= high)) {
+      return npos;
+    }
+    double xl =
+        log_base ? (std::log(x) / std::log(double(log_base))) : std::log(x);
+    return snap_to_edges(x, std::floor((xl - log_low) / width));
+  }
+  case kind_t::edges: {
+    if ((x != 0) && !std::isnormal(x)) {
+      return reject(x);
+    }
+    if ((x < low) || (x >= high)) {
+      return npos;
+    }
+    return index_t(std::upper_bound(edges.begin(), edges.end(), x) -
+                   edges.begin() - 1);
+  }
+  default: {
+    return npos;
+  }
+  }
+}
+
+inline Binning::index_t
+Binning::AxisKernel::snap_to_edges(double x, double estimate) const {
+  index_t bin = std::min(std::max(estimate, 0.0), double(nbins - 1));
+  if (x < edges[bin]) {
+    return bin - 1;
+  }
+  if (x >= edges[bin + 1]) {
+    return bin + 1;
+  }
+  return bin;
+}
+
 // sort bins based on extent in each dimension in decreasing dimension order
 // so that neighbouring bins are neighbouring in the first axis.
 bool operator<(Binning::BinExtents const &, Binning::BinExtents const &);
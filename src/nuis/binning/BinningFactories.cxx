@@ -1,12 +1,79 @@
 #include "nuis/binning/Binning.h"
 
+#include "nuis/binning/BinExtentsIndex.h"
 #include "nuis/binning/log_bin_edges.txx"
 #include "nuis/binning/utility.h"
 
 #include "fmt/ranges.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace nuis {
 
+namespace {
+
+using BinnableMask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+
+// Checks that a batch of projections has a column for every axis, mirroring
+// the empty projection vector handling of the scalar binning functions.
+bool batch_has_axes(std::string const &fname,
+                    Binning::ProjectionsRef const &x, size_t nax,
+                    Binning::BinIndices &bins_out) {
+  if (size_t(x.cols()) >= nax) {
+    return true;
+  }
+  Binning::log_warn("[{}.batch_binning_function] was passed {} projection "
+                    "columns for {} axes. Returning npos. Compile with "
+                    "CMAKE_BUILD_TYPE=Debug to make this an exception.",
+                    fname, x.cols(), nax);
+#ifndef NUIS_NDEBUG
+  throw TooFewProjectionsForBinning();
+#endif
+  bins_out.setConstant(Binning::npos);
+  return false;
+}
+
+// Entries that the scalar binning functions accept: zero or normal numbers.
+// Warns once per batch about any others.
+BinnableMask batch_binnable(std::string const &fname,
+                            Eigen::Ref<Eigen::ArrayXd const> const &x,
+                            bool allow_zero = true) {
+  BinnableMask binnable =
+      x.isFinite() && (x.abs() >= std::numeric_limits<double>::min());
+  if (allow_zero) {
+    binnable = binnable || (x == 0);
+  }
+
+  auto nabnormal = binnable.size() - binnable.count();
+  if (nabnormal) {
+    Binning::log_warn("[{}.batch_binning_function] was passed {} abnornmal "
+                      "numbers. Returning npos for these entries. Compile with "
+                      "CMAKE_BUILD_TYPE=Debug to make this an exception.",
+                      fname, nabnormal);
+#ifndef NUIS_NDEBUG
+    throw UnbinnableNumber();
+#endif
+  }
+  return binnable;
+}
+
+// floor((x - start) / width) for entries in the range, clamped to the last
+// bin to guard against rounding just below the upper edge. Entries outside of
+// in_range are replaced with start before the cast, so that no unrepresentable
+// values are ever converted to index_t.
+Binning::BinIndices
+batch_uniform_bins(Eigen::Ref<Eigen::ArrayXd const> const &x,
+                   BinnableMask const &in_range, double start, double width,
+                   size_t nbins) {
+  return ((in_range.select(x, start) - start) / width)
+      .floor()
+      .min(double(nbins - 1))
+      .cast<Binning::index_t>();
+}
+
+} // namespace
+
 BinningPtr Binning::lin_space(double start, double stop, size_t nbins,
                               std::string const &label) {
 
@@ -25,6 +92,15 @@ BinningPtr Binning::lin_space(double start, double stop, size_t nbins,
   BinningPtr bin_info = std::make_shared<Binning>();
   bin_info->axis_labels.push_back(label);
 
+  bin_info->axis_kernel.kind = AxisKernel::kind_t::uniform;
+  bin_info->axis_kernel.low = start;
+  bin_info->axis_kernel.high = stop;
+  bin_info->axis_kernel.nbins = nbins;
+  bin_info->axis_kernel.width = width;
+  bin_info->axis_kernel.name = fmt::format("lin_space({},{},{})", start, stop,
+                                           nbins);
+  auto kernel = bin_info->axis_kernel;
+
   // be careful not to capture bin_info or you will create a circular reference
   // for the shared_ptr
   bin_info->binning_function = [=](std::vector<double> const &x) -> index_t {
@@ -43,37 +119,23 @@ BinningPtr Binning::lin_space(double start, double stop, size_t nbins,
       return npos;
     }
 
-    if ((x[0] != 0) && !std::isnormal(x[0])) {
-      log_warn("[lin_space({},{},{}).binning_function] was passed an "
-               "abnornmal number = {}. Returning npos. Compile with "
-               "CMAKE_BUILD_TYPE=Debug to make this an exception.",
-               start, stop, nbins, x[0]);
-#ifndef NUIS_NDEBUG
-      throw UnbinnableNumber();
-#endif
-      return Binning::npos;
-    }
-
-    if (x[0] >= stop) {
-      NUIS_LOG_TRACE("[lin_space({},{},{}).binning_function]: {} above extent. "
-                     "Returning npos.",
-                     start, stop, nbins, x[0]);
-      return npos;
-    }
+    index_t bin = kernel(x[0]);
+    NUIS_LOG_TRACE("[lin_space({},{},{}).binning_function] Found bin: {}, v = "
+                   "{}",
+                   start, stop, nbins, bin, x[0]);
+    return bin;
+  };
 
-    if (x[0] < start) {
-      NUIS_LOG_TRACE("[lin_space({},{},{}).binning_function]: {} below extent. "
-                     "Returning npos.",
-                     start, stop, nbins, x[0]);
-      return npos;
+  bin_info->batch_binning_function = [=](ProjectionsRef const &x,
+                                         BinIndices &bins_out) {
+    if (!batch_has_axes("lin_space", x, 1, bins_out)) {
+      return;
     }
-
-    index_t bin = std::floor((x[0] - start) / width);
-    NUIS_LOG_TRACE(
-        "[lin_space({},{},{}).binning_function] Found bin: {}, v = {} "
-        "is in ({} -- {})",
-        start, stop, nbins, bin, x[0], bins[bin][0].low, bins[bin][0].high);
-    return bin;
+    auto x0 = x.col(0);
+    BinnableMask in_range =
+        batch_binnable("lin_space", x0) && (x0 >= start) && (x0 < stop);
+    bins_out = in_range.select(
+        batch_uniform_bins(x0, in_range, start, width, nbins), npos);
   };
 
   bin_info->bins = bins;
@@ -184,7 +246,11 @@ Binning::lin_spaceND(std::vector<std::tuple<double, double, size_t>> axes,
         return npos;
       }
 
-      index_t dimbin = std::floor((x[ax_i] - ax_start) / axis_bin_widths[ax_i]);
+      // guard against rounding just below the upper edge
+      index_t dimbin =
+          std::min(index_t(std::floor((x[ax_i] - ax_start) /
+                                      axis_bin_widths[ax_i])),
+                   index_t(std::get<2>(axes[ax_i]) - 1));
 
       NUIS_LOG_TRACE(
           "[lin_spaceND({}).binning_function] Found bin[{}]: {}, v = {} "
@@ -204,6 +270,31 @@ Binning::lin_spaceND(std::vector<std::tuple<double, double, size_t>> axes,
 
     return gbin;
   };
+
+  bin_info->batch_binning_function = [=](ProjectionsRef const &x,
+                                         BinIndices &bins_out) {
+    if (!batch_has_axes("lin_spaceND", x, nax, bins_out)) {
+      return;
+    }
+
+    BinnableMask in_range = BinnableMask::Constant(x.rows(), true);
+    for (size_t ax_i = 0; ax_i < nax; ++ax_i) {
+      auto xa = x.col(ax_i);
+      in_range = in_range && batch_binnable("lin_spaceND", xa) &&
+                 (xa >= std::get<0>(axes[ax_i])) &&
+                 (xa < std::get<1>(axes[ax_i]));
+    }
+
+    BinIndices gbin = BinIndices::Zero(x.rows());
+    for (size_t ax_i = 0; ax_i < nax; ++ax_i) {
+      gbin += batch_uniform_bins(x.col(ax_i), in_range, std::get<0>(axes[ax_i]),
+                                 axis_bin_widths[ax_i],
+                                 std::get<2>(axes[ax_i])) *
+              index_t(nbins_in_slice[ax_i]);
+    }
+    bins_out = in_range.select(gbin, npos);
+  };
+
   bin_info->bins = bins;
   return bin_info;
 }
@@ -220,14 +311,27 @@ BinningPtr log_space_impl(double start, double stop, size_t nbins,
 
   double lwidth = (stopl - startl) / double(nbins);
 
-  std::vector<Binning::BinExtents> bins =
-      edges_to_extents(log_spaced_edges<base>(start, stop, nbins));
+  auto edges = log_spaced_edges<base>(start, stop, nbins);
+  std::vector<Binning::BinExtents> bins = edges_to_extents(edges);
 
   Binning::log_trace("[log{}_space({},{},{})] startl={} stopl={} lwidth={}",
                      base == 0 ? "" : std::to_string(base), start, stop, nbins,
                      startl, stopl, lwidth);
   Binning::log_trace("  {}", str_via_ss(bins));
 
+  bin_info->axis_kernel.kind = Binning::AxisKernel::kind_t::logarithmic;
+  bin_info->axis_kernel.low = edges.front();
+  bin_info->axis_kernel.high = edges.back();
+  bin_info->axis_kernel.nbins = nbins;
+  bin_info->axis_kernel.width = lwidth;
+  bin_info->axis_kernel.log_base = base;
+  bin_info->axis_kernel.log_low = startl;
+  bin_info->axis_kernel.edges = edges;
+  bin_info->axis_kernel.name =
+      fmt::format("log{}_space({},{},{})",
+                  base == 0 ? "" : std::to_string(base), start, stop, nbins);
+  auto kernel = bin_info->axis_kernel;
+
   // be careful not to capture bin_info or you will create a circular reference
   // for the shared_ptr
   bin_info->binning_function =
@@ -251,57 +355,50 @@ BinningPtr log_space_impl(double start, double stop, size_t nbins,
       return Binning::npos;
     }
 
-    if (!std::isnormal(x[0])) {
-      Binning::log_warn(
-          "[log{}_space({},{},{}).binning_function] was passed an "
-          "abnornmal number = {}. Returning npos. Compile with "
-          "CMAKE_BUILD_TYPE=Debug to make this an exception.",
-          base == 0 ? "" : std::to_string(base), start, stop, nbins, x[0]);
-#ifndef NUIS_NDEBUG
-      throw UnbinnableNumber();
-#endif
-      return Binning::npos;
-    }
+    Binning::index_t bin = kernel(x[0]);
+    NUIS_LOGGER_TRACE("Binning",
+                      "[log{}_space({},{},{}).binning_function] Found bin: {}, "
+                      "v = {}",
+                      base == 0 ? "" : std::to_string(base), start, stop, nbins,
+                      bin, x[0]);
+    return bin;
+  };
 
-    if (x[0] < 0) {
-      Binning::log_info(
-          "[log{}_space({},{},{}).binning_function] was passed an "
-          "unloggable number = {}. Returning npos. Compile with "
-          "CMAKE_BUILD_TYPE=Debug to make this an exception.",
-          base == 0 ? "" : std::to_string(base), start, stop, nbins, x[0]);
+  std::string fname =
+      fmt::format("log{}_space", base == 0 ? "" : std::to_string(base));
+  bin_info->batch_binning_function = [=](Binning::ProjectionsRef const &x,
+                                         Binning::BinIndices &bins_out) {
+    if (!batch_has_axes(fname, x, 1, bins_out)) {
+      return;
+    }
+    auto x0 = x.col(0);
+
+    auto nunloggable = (x0 < 0).count();
+    if (nunloggable) {
+      Binning::log_info("[{}.batch_binning_function] was passed {} unloggable "
+                        "numbers. Returning npos for these entries. Compile "
+                        "with CMAKE_BUILD_TYPE=Debug to make this an "
+                        "exception.",
+                        fname, nunloggable);
 #ifndef NUIS_NDEBUG
       throw UnbinnableNumber();
 #endif
-      return Binning::npos;
     }
 
-    auto xl = logbase<base>(x[0]);
+    BinnableMask in_range = batch_binnable(fname, x0, false) &&
+                            (x0 >= edges.front()) && (x0 < edges.back());
 
-    if (xl >= stopl) {
-      NUIS_LOGGER_TRACE("Binning",
-                        "[log{}_space({},{},{}).binning_function] {} above "
-                        "extent. Returning npos.",
-                        base == 0 ? "" : std::to_string(base), start, stop,
-                        nbins, x[0]);
-      return Binning::npos;
+    Eigen::ArrayXd xl = in_range.select(x0, start).log();
+    if (base != 0) {
+      xl /= std::log(double(base));
     }
+    Eigen::ArrayXd estimate = ((xl - startl) / lwidth).floor();
 
-    if (xl < startl) {
-      NUIS_LOGGER_TRACE("Binning",
-                        "[log{}_space({},{},{}).binning_function] {} below "
-                        "extent. Returning npos.",
-                        base == 0 ? "" : std::to_string(base), start, stop,
-                        nbins, x[0]);
-      return Binning::npos;
+    bins_out.resize(x.rows());
+    for (Eigen::Index i = 0; i < x.rows(); ++i) {
+      bins_out[i] = in_range[i] ? kernel.snap_to_edges(x0[i], estimate[i])
+                                : Binning::npos;
     }
-
-    Binning::index_t bin = std::floor((xl - startl) / lwidth);
-    NUIS_LOGGER_TRACE("Binning",
-                      "[log{}_space({},{},{}).binning_function] Found bin: {}, "
-                      "v = {} is in ({} -- {})",
-                      base == 0 ? "" : std::to_string(base), start, stop, nbins,
-                      bin, x[0], bins[bin][0].low, bins[bin][0].high);
-    return bin;
   };
 
   bin_info->bins = bins;
@@ -327,6 +424,14 @@ BinningPtr Binning::contiguous(std::vector<double> const &edges,
 
   bin_info->axis_labels.push_back(label);
 
+  bin_info->axis_kernel.kind = AxisKernel::kind_t::edges;
+  bin_info->axis_kernel.low = edges.front();
+  bin_info->axis_kernel.high = edges.back();
+  bin_info->axis_kernel.nbins = bins.size();
+  bin_info->axis_kernel.edges = edges;
+  bin_info->axis_kernel.name = "contiguous";
+  auto kernel = bin_info->axis_kernel;
+
   // be careful not to capture bin_info or you will create a circular reference
   // for the shared_ptr
   bin_info->binning_function = [=](std::vector<double> const &x) -> index_t {
@@ -340,161 +445,49 @@ BinningPtr Binning::contiguous(std::vector<double> const &edges,
       return npos;
     }
 
-    if ((x[0] != 0) && !std::isnormal(x[0])) {
-      log_warn("[contiguous.binning_function] was passed an "
-               "abnornmal number = {}. Returning npos. Compile with "
-               "CMAKE_BUILD_TYPE=Debug to make this an exception.",
-               x[0]);
-#ifndef NUIS_NDEBUG
-      throw UnbinnableNumber();
-#endif
-      return npos;
-    }
+    index_t bin = kernel(x[0]);
+    NUIS_LOG_TRACE("[contiguous.binning_function] Found bin: {}, v = {}", bin,
+                   x[0]);
+    return bin;
+  };
 
-    if (x[0] < bins.front()[0].low) {
-      NUIS_LOG_TRACE(
-          "[contiguous.binning_function] x = {} < binning low edge = {}, "
-          "returning npos.",
-          x[0], bins.front()[0].low);
-      return npos;
+  bin_info->batch_binning_function = [=](ProjectionsRef const &x,
+                                         BinIndices &bins_out) {
+    if (!batch_has_axes("contiguous", x, 1, bins_out)) {
+      return;
     }
-    if (x[0] >= bins.back()[0].high) {
-      NUIS_LOG_TRACE(
-          "[contiguous.binning_function] x = {} >= binning high edge = {}, "
-          "returning npos.",
-          x[0], bins.back()[0].high);
-      return npos;
+    auto x0 = x.col(0);
+    BinnableMask in_range = batch_binnable("contiguous", x0) &&
+                            (x0 >= edges.front()) &&
+                            (x0 < edges.back());
+    Eigen::ArrayXd xs = in_range.select(x0, edges.front());
+
+    // for a few edges, counting the edges below each entry is branchless and
+    // vectorizes, for many, binary search each entry.
+    size_t const max_edges_to_count = 32;
+    if (edges.size() <= max_edges_to_count) {
+      BinIndices bin = BinIndices::Zero(x.rows());
+      for (size_t i = 1; i + 1 < edges.size(); ++i) {
+        bin += (xs >= edges[i]).cast<index_t>();
+      }
+      bins_out = in_range.select(bin, npos);
+      return;
     }
 
-    // binary search for bin
-    size_t L = 0;
-    size_t R = bins.size() - 1;
-    NUIS_LOG_TRACE(
-        "[contiguous.binning_function]: begin binary search: {{ x: {}, L: "
-        "{}, R: {} }}.",
-        x[0], L, R);
-    while (L <= R) {
-      size_t m = std::floor((L + R) / 2);
-      NUIS_LOG_TRACE(
-          "[contiguous.binning_function]: checking {{ x: {}, m: {}, low: "
-          "{}, high: {}}}.",
-          x[0], m, bins[m][0].low, bins[m][0].high);
-      if ((bins[m][0].low <= x[0]) && (bins[m][0].high > x[0])) {
-        NUIS_LOG_TRACE(
-            "[contiguous.binning_function]: binary search succeeded, in "
-            "bin: {} < {} < {}",
-            bins[m][0].low, bins[m][0].high, x[0]);
-        return m;
-      } else if (bins[m][0].high <= x[0]) {
-        L = m + 1;
-        NUIS_LOG_TRACE("  -- {} < {}: L = {}", bins[m][0].high, x[0], L);
-      } else if (bins[m][0].low > x[0]) {
-        R = m - 1;
-        NUIS_LOG_TRACE("  -- {} > {}: R = {}", bins[m][0].low, x[0], R);
-      }
+    bins_out.resize(x.rows());
+    for (Eigen::Index i = 0; i < x.rows(); ++i) {
+      bins_out[i] = in_range[i]
+                        ? index_t(std::upper_bound(edges.begin(),
+                                                   edges.end(), xs[i]) -
+                                  edges.begin() - 1)
+                        : npos;
     }
-    NUIS_LOG_TRACE(
-        "[contiguous.binning_function]: binary search failed, returning npos.");
-    return npos;
   };
 
   bin_info->bins = bins;
   return bin_info;
 }
 
-struct from_extentsHelper : public nuis_named_log("Binning") {
-
-  std::vector<Binning::BinExtents> bins;
-  std::pair<size_t, std::vector<std::vector<Binning::index_t>>> bin_columns;
-
-  size_t nax;
-  size_t nbins;
-
-  from_extentsHelper(std::vector<Binning::BinExtents> const &bi) : bins(bi) {
-
-    if (!bins.size()) {
-      log_critical("[from_extentsHelper]: Passed empty bins.");
-      throw EmptyBinning();
-    }
-
-    nax = bins.front().size();
-    nbins = bins.size();
-
-    bin_columns = get_bin_columns(bins);
-  }
-
-  Binning::index_t operator()(std::vector<double> const &x) const {
-
-    if (x.size() < nax) {
-      log_critical("[from_extentsHelper]: projections passed in: {} is "
-                   "smaller than the number of axes in a bin: {}",
-                   x, nax);
-      throw MismatchedAxisCount();
-    }
-
-    auto longax = bin_columns.first;
-    bool found_column = false;
-
-    NUIS_LOG_TRACE(">>>>>>>>>>>>>>>>>>>>> Search begin x = {}", x);
-
-    for (size_t col_it = 0; col_it < bin_columns.second.size(); ++col_it) {
-      auto const &col = bin_columns.second[col_it];
-      auto const &ext = bins[col.front()][longax];
-
-      if (ext.contains(x[longax])) {
-
-#ifndef NUIS_NDEBUG
-        NUIS_LOG_TRACE("[from_extentsHelper]: "
-                       "++ x[{}] = {} in Column {}, {}",
-                       longax, x[longax], col_it, str_via_ss(ext));
-#endif
-
-        found_column = true;
-
-        for (Binning::index_t bi_it : col) {
-          bool found_bin = true;
-#ifndef NUIS_NDEBUG
-          NUIS_LOG_TRACE("[from_extentsHelper]:   checking x = {} in bin ={}",
-                         x, str_via_ss(bins[bi_it]));
-#endif
-          for (size_t ax_it = 0; ax_it < nax; ++ax_it) {
-            if (!bins[bi_it][ax_it].contains(x[ax_it])) {
-              found_bin = false;
-              break;
-            }
-          }
-          if (found_bin) {
-            NUIS_LOG_TRACE("[from_extentsHelper]: Found bin x = {} in {}", x,
-                           str_via_ss(bins[bi_it]));
-            NUIS_LOG_TRACE("<<<<<<<<<<<<<<<<<<<<< Search end");
-            return bi_it;
-          }
-#ifndef NUIS_NDEBUG
-          else {
-            NUIS_LOG_TRACE("[from_extentsHelper]:   -- Nope.");
-          }
-#endif
-        }
-      } else {
-        NUIS_LOG_TRACE("[from_extentsHelper]: "
-                       "-- x[{}] = {} not in Column {}, {}",
-                       longax, x[longax], col_it, str_via_ss(ext));
-
-        // we should be able to make this optimization but can't currently figure out how to order the bins correctly.
-        (void)found_column;
-        // if (found_column) { // left the columns that can contain this value
-        //   break;
-        // }
-      }
-    }
-
-    NUIS_LOG_TRACE("[from_extentsHelper]: returning npos");
-    NUIS_LOG_TRACE("<<<<<<<<<<<<<<<<<<<<< Search end");
-
-    return Binning::npos;
-  }
-};
-
 BinningPtr Binning::from_extents(std::vector<BinExtents> bins,
                                  std::vector<std::string> const &labels) {
 
@@ -528,7 +521,17 @@ BinningPtr Binning::from_extents(std::vector<BinExtents> bins,
     throw BinningHasOverlaps();
   }
 
-  bin_info->binning_function = from_extentsHelper(bins);
+  auto index = std::make_shared<BinExtentsIndex const>(bins);
+
+  bin_info->binning_function =
+      [=](std::vector<double> const &x) -> Binning::index_t {
+    return (*index)(x);
+  };
+
+  bin_info->batch_binning_function = [=](ProjectionsRef const &x,
+                                         BinIndices &bins_out) {
+    (*index)(x, bins_out);
+  };
 
   bin_info->bins = bins;
   return bin_info;
@@ -682,6 +685,29 @@ BinningPtr Binning::product(std::vector<BinningPtr> binnings) {
     NUIS_LOG_TRACE("[product]: Returning gbin {}", gbin);
     return gbin;
   };
+
+  bin_info_product->batch_binning_function = [=](ProjectionsRef const &x,
+                                                 BinIndices &bins_out) {
+    if (size_t(x.cols()) < nax) {
+      log_critical("[product]: projections passed in have {} columns, "
+                   "fewer than the number of axes in a bin: {}",
+                   x.cols(), nax);
+      throw MismatchedAxisCount();
+    }
+
+    BinIndices gbin = BinIndices::Zero(x.rows());
+    BinnableMask found = BinnableMask::Constant(x.rows(), true);
+    size_t nax_consumed = 0;
+    for (size_t binning_it = 0; binning_it < binnings.size(); ++binning_it) {
+      auto binning_bins = binnings[binning_it]->find_bins(
+          x.middleCols(nax_consumed, nax_in_binning[binning_it]));
+      found = found && (binning_bins != npos);
+      gbin += (binning_bins != npos).select(binning_bins, 0) *
+              index_t(nbins_in_binning_slice[binning_it]);
+      nax_consumed += nax_in_binning[binning_it];
+    }
+    bins_out = found.select(gbin, npos);
+  };
   bin_info_product->bins =
       binning_product_recursive(binnings.rbegin(), binnings.rend());
   return bin_info_product;
@@ -7,9 +7,36 @@
 
 #include <sstream>
 
+#define COLUMN_TYPE_ITER                                                       \
+  X(bool)                                                                      \
+  X(int)                                                                       \
+  X(uint)                                                                      \
+  X(int16_t)                                                                   \
+  X(uint16_t)                                                                  \
+  X(float)                                                                     \
+  X(double)
+
 namespace nuis {
+std::shared_ptr<EventFrame::ColumnIndex const>
+EventFrame::make_column_index(std::vector<std::string> const &cns) {
+  auto idx = std::make_shared<ColumnIndex>();
+  idx->reserve(cns.size());
+  for (size_t i = 0; i < cns.size(); ++i) {
+    idx->emplace(cns[i], column_t(i));
+  }
+  return idx;
+}
+
 EventFrame::column_t
 EventFrame::find_column_index(std::string const &cn) const {
+  if (column_index) {
+    auto it = column_index->find(cn);
+    if ((it != column_index->end()) && (it->second < column_names.size()) &&
+        (column_names[it->second] == cn)) {
+      return it->second;
+    }
+  }
+
   auto pos = std::find(column_names.begin(), column_names.end(), cn);
   if (pos == column_names.end()) {
     return EventFrame::npos;
@@ -17,6 +44,40 @@ EventFrame::find_column_index(std::string const &cn) const {
   return pos - column_names.begin();
 }
 
+EventFrame::ColumnLocation
+EventFrame::column_handle(std::string const &cn) const {
+  auto cid = find_column_index(cn);
+  if (cid == EventFrame::npos) {
+    nuis_named_log("EventFrame")::log_critical(
+        "Tried to get handle for column, named {} from Eventframe. But no "
+        "such column exists.",
+        cn);
+    throw InvalidFrameColumnName() << cn;
+  }
+  return column_location(cid);
+}
+
+ConstTypedColumnSpan<double>
+EventFrame::span_as_double(ColumnLocation loc, Eigen::ArrayXd &scratch) const {
+  switch (loc.typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id: {                                                   \
+    if constexpr (std::is_same_v<t, double>) {                                 \
+      return span<double>(loc);                                                \
+    }                                                                          \
+    scratch = span<t>(loc).unaryExpr(                                          \
+        [](t v) { return widen_column_value<t>(v); });                         \
+    break;                                                                     \
+  }
+    COLUMN_TYPE_ITER
+#undef X
+  default: {
+    throw InvalidFrameColumnType() << "unknown column type " << loc.typenum;
+  }
+  }
+  return {scratch.data(), scratch.size()};
+}
+
 Eigen::ArrayXdRef EventFrame::col(std::string const &cn) {
   auto cid = find_column_index(cn);
   if (cid == EventFrame::npos) {
@@ -26,7 +87,15 @@ Eigen::ArrayXdRef EventFrame::col(std::string const &cn) {
         cn);
     throw InvalidFrameColumnName();
   }
-  return table.col(cid);
+  auto loc = column_location(cid);
+  if (loc.typenum != column_type<double>::id) {
+    nuis_named_log("EventFrame")::log_critical(
+        "Tried to get column, named {} from Eventframe as double, but it is "
+        "stored natively as {}. Use EventFrame::col<T>.",
+        cn, column_typenum_as_string(loc.typenum));
+    throw InvalidFrameColumnType();
+  }
+  return table.col(loc.index);
 }
 std::vector<Eigen::ArrayXdRef>
 EventFrame::cols(std::vector<std::string> const &cns) {
@@ -40,16 +109,54 @@ EventFrame::cols(std::vector<std::string> const &cns) {
           cns[i]);
       throw InvalidFrameColumnName();
     }
-    rtn.push_back(table.col(cid));
+    rtn.push_back(col(cns[i]));
+  }
+  return rtn;
+}
+
+EventFrame EventFrame::widened() const {
+  if (column_locations.empty()) {
+    return *this;
+  }
+
+  Eigen::ArrayXXd wide(table.rows(), column_names.size());
+  for (size_t cid = 0; cid < column_names.size(); ++cid) {
+    auto const &[typenum, index] = column_locations[cid];
+    switch (typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id: {                                                   \
+    wide.col(cid) = typed_table<t>().col(index).unaryExpr(                     \
+        [](t v) { return widen_column_value<t>(v); });                         \
+    break;                                                                     \
+  }
+      COLUMN_TYPE_ITER
+#undef X
+    }
   }
+  EventFrame rtn{column_names, wide, num_rows, norm_info};
+  rtn.column_index = column_index;
   return rtn;
 }
 
+void EventFrame::conservative_resize(size_t nrows) {
+#define X(t)                                                                   \
+  typed_table<t>().conservativeResize(nrows, typed_table<t>().cols());
+  COLUMN_TYPE_ITER
+#undef X
+  num_rows = nrows;
+}
+
 std::ostream &operator<<(std::ostream &os, nuis::EventFramePrinter fp) {
 
   size_t abs_max_width = fp.max_col_width;
 
-  auto const &f = fp.fr.get();
+  // natively typed columns are printed as double
+  auto const &orig = fp.fr.get();
+  EventFrame wide;
+  if (orig.column_locations.size()) {
+    wide = orig.widened();
+  }
+  auto const &f = orig.column_locations.size() ? wide : orig;
 
   if (!fp.prettyprint) {
     return os << f.table.topRows(fp.max_rows);
@@ -2,6 +2,7 @@
 
 #include "nuis/eventinput/INormalizedEventSource.h"
 
+#include "nuis/eventframe/column_types.h"
 #include "nuis/eventframe/missing_datum.h"
 
 #include "nuis/except.h"
@@ -9,7 +10,9 @@
 #include "Eigen/Dense"
 
 #include <iostream>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Eigen {
@@ -19,6 +22,20 @@ using ArrayXdRef = Ref<ArrayXd, 0, Stride<Dynamic, Dynamic>>;
 namespace nuis {
 
 NEW_NUISANCE_EXCEPT(InvalidFrameColumnName);
+NEW_NUISANCE_EXCEPT(InvalidFrameColumnType);
+
+template <typename T>
+using TypedColumnTable = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>;
+template <typename T>
+using TypedColumnRef =
+    Eigen::Ref<Eigen::Array<T, Eigen::Dynamic, 1>, 0,
+               Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+// A contiguous view of every row of a single column
+template <typename T>
+using TypedColumnSpan = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+template <typename T>
+using ConstTypedColumnSpan =
+    Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1> const>;
 
 struct EventFrame {
   std::vector<std::string> column_names;
@@ -29,14 +46,160 @@ struct EventFrame {
   using column_t = uint16_t;
   constexpr static column_t const npos = std::numeric_limits<column_t>::max();
 
+  // Where a column is stored: the column_type<T>::id of the table it is in and
+  // the column index in that table.
+  struct ColumnLocation {
+    int typenum;
+    column_t index;
+  };
+
+  // If empty, every column is stored in table, widened to double, at the same
+  // index as in column_names. Otherwise, e.g. for frames generated with
+  // EventFrameGen::typed_storage, there is one entry per column and columns
+  // that are not of type double are stored natively in the typed tables below.
+  std::vector<ColumnLocation> column_locations = {};
+
+  TypedColumnTable<bool> bool_table = {};
+  TypedColumnTable<int> int_table = {};
+  TypedColumnTable<uint> uint_table = {};
+  TypedColumnTable<int16_t> int16_table = {};
+  TypedColumnTable<uint16_t> uint16_table = {};
+  TypedColumnTable<float> float_table = {};
+
+  using ColumnIndex = std::unordered_map<std::string, column_t>;
+  // An optional hashed lookup from column name to column index, built by
+  // index_columns. Frames produced by the same EventFrameGen share one index.
+  // If column_names is modified after indexing, find_column_index falls back
+  // to a linear search for names that the index no longer matches.
+  std::shared_ptr<ColumnIndex const> column_index = nullptr;
+
+  static std::shared_ptr<ColumnIndex const>
+  make_column_index(std::vector<std::string> const &column_names);
+  // (Re)builds column_index from column_names
+  void index_columns() { column_index = make_column_index(column_names); }
+
   column_t find_column_index(std::string const &name) const;
 
+  // Resolves a column name to its storage location once, so that the result
+  // can be reused to access the same column in many frames with the same
+  // layout, e.g. every chunk from one EventFrameGen. Throws
+  // InvalidFrameColumnName if no such column exists.
+  ColumnLocation column_handle(std::string const &cn) const;
+
+  ColumnLocation column_location(column_t cid) const {
+    return column_locations.size()
+               ? column_locations[cid]
+               : ColumnLocation{column_type<double>::id, cid};
+  }
+
+  // The table that holds columns of type T, table for double
+  template <typename T> TypedColumnTable<T> &typed_table();
+  template <typename T> TypedColumnTable<T> const &typed_table() const;
+
   Eigen::ArrayXdRef col(std::string const &cn);
   std::vector<Eigen::ArrayXdRef> cols(std::vector<std::string> const &cns);
 
+  // A reference to a natively stored column, without conversion. Throws
+  // InvalidFrameColumnType if the column is not stored as T.
+  template <typename T> TypedColumnRef<T> col(std::string const &cn);
+
+  // Contiguous views of a column located with column_handle. Throws
+  // InvalidFrameColumnType if the column is not stored as T.
+  template <typename T> TypedColumnSpan<T> span(ColumnLocation loc);
+  template <typename T> ConstTypedColumnSpan<T> span(ColumnLocation loc) const;
+
+  // A contiguous view of a column as double. Columns stored natively as
+  // another type are widened into scratch, which must outlive the view.
+  ConstTypedColumnSpan<double> span_as_double(ColumnLocation loc,
+                                              Eigen::ArrayXd &scratch) const;
+
+  // A copy of this frame with every column stored in table as double
+  EventFrame widened() const;
+
+  // Resizes every table to nrows rows, keeping existing entries
+  void conservative_resize(size_t nrows);
+
   explicit operator bool() const { return table.rows(); }
 };
 
+template <typename T> TypedColumnTable<T> &EventFrame::typed_table() {
+  return const_cast<TypedColumnTable<T> &>(
+      static_cast<EventFrame const *>(this)->typed_table<T>());
+}
+
+template <typename T>
+TypedColumnTable<T> const &EventFrame::typed_table() const {
+  if constexpr (std::is_same_v<T, bool>) {
+    return bool_table;
+  } else if constexpr (std::is_same_v<T, int>) {
+    return int_table;
+  } else if constexpr (std::is_same_v<T, uint>) {
+    return uint_table;
+  } else if constexpr (std::is_same_v<T, int16_t>) {
+    return int16_table;
+  } else if constexpr (std::is_same_v<T, uint16_t>) {
+    return uint16_table;
+  } else if constexpr (std::is_same_v<T, float>) {
+    return float_table;
+  } else {
+    static_assert(std::is_same_v<T, double>,
+                  "EventFrame has no table for this column type");
+    return table;
+  }
+}
+
+template <typename T>
+TypedColumnRef<T> EventFrame::col(std::string const &cn) {
+  auto cid = find_column_index(cn);
+  if (cid == EventFrame::npos) {
+    throw InvalidFrameColumnName() << cn;
+  }
+  auto loc = column_location(cid);
+  if (loc.typenum != column_type<T>::id) {
+    throw InvalidFrameColumnType()
+        << cn << " is stored as " << column_typenum_as_string(loc.typenum)
+        << ", not " << column_typenum_as_string(column_type<T>::id);
+  }
+  return typed_table<T>().col(loc.index);
+}
+
+template <typename T>
+TypedColumnSpan<T> EventFrame::span(ColumnLocation loc) {
+  auto cspan = static_cast<EventFrame const *>(this)->span<T>(loc);
+  return {const_cast<T *>(cspan.data()), cspan.size()};
+}
+
+template <typename T>
+ConstTypedColumnSpan<T> EventFrame::span(ColumnLocation loc) const {
+  if (loc.typenum != column_type<T>::id) {
+    throw InvalidFrameColumnType()
+        << "column is stored as " << column_typenum_as_string(loc.typenum)
+        << ", not " << column_typenum_as_string(column_type<T>::id);
+  }
+  auto const &tab = typed_table<T>();
+  return {tab.col(loc.index).data(), tab.rows()};
+}
+
+// Converts a natively stored value to double, mapping missing data markers
+template <typename T> inline double widen_column_value(T v) {
+  if constexpr (!std::is_same_v<T, bool>) {
+    if (v == kMissingDatum<T>) {
+      return kMissingDatum<double>;
+    }
+  }
+  return double(v);
+}
+
+// The inverse of widen_column_value
+template <typename T> inline T narrow_column_value(double v) {
+  if constexpr (!std::is_same_v<T, bool>) {
+    if (v == kMissingDatum<double>) {
+      return kMissingDatum<T>;
+    }
+  }
+  return T(v);
+}
+
 struct EventFramePrinter {
   std::reference_wrapper<EventFrame const> fr;
   int max_rows;
@@ -0,0 +1,290 @@
+#include "nuis/eventframe/EventFrameCache.h"
+
+#include "nuis/log.txx"
+
+#include "fmt/core.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nuis {
+
+namespace {
+
+constexpr char const cache_magic[8] = {'N', 'U', 'I', 'S', 'E', 'F', 'C', '\0'};
+constexpr uint64_t cache_version = 1;
+constexpr uint64_t cache_data_alignment = 64;
+
+// The file starts with this header, followed by the column names and types
+// at names_offset. From data_offset, the (ncols + 3) * nrows doubles are laid
+// out column-by-column: the ncols frame columns followed by the fatx,
+// sumweights, and nevents of the normalization state as each row's event was
+// read. The file uses the native byte order and is not intended to be portable.
+struct CacheHeader {
+  char magic[8];
+  uint64_t version;
+  uint64_t key;
+  uint64_t nrows;
+  uint64_t ncols;
+  double fatx;
+  double sumweights;
+  uint64_t nevents;
+  uint64_t names_offset;
+  uint64_t data_offset;
+};
+
+size_t const nnorm_cols = 3;
+
+} // namespace
+
+uint64_t fnv1a64(void const *data, size_t size, uint64_t seed) {
+  auto bytes = static_cast<unsigned char const *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 0x100000001b3ULL;
+  }
+  return seed;
+}
+
+uint64_t hash_input_files(std::vector<std::filesystem::path> const &paths) {
+  uint64_t hash = fnv1a64("nuis::hash_input_files");
+  for (auto const &p : paths) {
+    std::error_code ec;
+    auto canon = std::filesystem::canonical(p, ec);
+    if (ec) {
+      log_warn("hash_input_files: cannot resolve input {}, only its path will "
+               "contribute to the cache key.",
+               p.native());
+      hash = fnv1a64(p.native(), hash);
+      continue;
+    }
+    hash = fnv1a64(canon.native(), hash);
+    uint64_t fsize = std::filesystem::file_size(canon);
+    hash = fnv1a64(&fsize, sizeof(fsize), hash);
+    int64_t mtime =
+        std::filesystem::last_write_time(canon).time_since_epoch().count();
+    hash = fnv1a64(&mtime, sizeof(mtime), hash);
+  }
+  return hash;
+}
+
+EventFrameCacheWriter::EventFrameCacheWriter(
+    std::filesystem::path const &p, uint64_t k,
+    std::vector<std::string> const &cns, std::vector<int> const &cts)
+    : path(p), tmppath(p), key(k), column_names(cns), column_types(cts),
+      nrows{0}, finalized{false} {
+  tmppath += fmt::format(".rows.{}", ::getpid());
+  tmp.open(tmppath, std::ios::binary | std::ios::trunc);
+  if (!tmp) {
+    log_critical("Failed to open EventFrame cache temporary file {}",
+                 tmppath.native());
+    throw EventFrameCacheIOError() << tmppath.native();
+  }
+}
+
+void EventFrameCacheWriter::append(EventFrame const &typed_frame,
+                                   std::vector<NormInfo> const &row_norms) {
+  // the cache stores all columns as double
+  EventFrame wide;
+  if (typed_frame.column_locations.size()) {
+    wide = typed_frame.widened();
+  }
+  auto const &frame = typed_frame.column_locations.size() ? wide : typed_frame;
+
+  size_t ncols = column_names.size();
+  std::vector<double> row(ncols + nnorm_cols);
+  for (size_t i = 0; i < frame.num_rows; ++i) {
+    for (size_t j = 0; j < ncols; ++j) {
+      row[j] = frame.table(i, j);
+    }
+    row[ncols] = row_norms[i].fatx;
+    row[ncols + 1] = row_norms[i].sumweights;
+    row[ncols + 2] = double(row_norms[i].nevents);
+    tmp.write(reinterpret_cast<char const *>(row.data()),
+              row.size() * sizeof(double));
+  }
+  nrows += frame.num_rows;
+}
+
+void EventFrameCacheWriter::finalize(NormInfo const &norm_info) {
+  tmp.close();
+
+  std::string names_blob;
+  for (size_t j = 0; j < column_names.size(); ++j) {
+    int64_t typenum = column_types[j];
+    uint64_t len = column_names[j].size();
+    names_blob.append(reinterpret_cast<char const *>(&typenum),
+                      sizeof(typenum));
+    names_blob.append(reinterpret_cast<char const *>(&len), sizeof(len));
+    names_blob.append(column_names[j]);
+  }
+
+  CacheHeader hdr;
+  std::memcpy(hdr.magic, cache_magic, sizeof(cache_magic));
+  hdr.version = cache_version;
+  hdr.key = key;
+  hdr.nrows = nrows;
+  hdr.ncols = column_names.size();
+  hdr.fatx = norm_info.fatx;
+  hdr.sumweights = norm_info.sumweights;
+  hdr.nevents = norm_info.nevents;
+  hdr.names_offset = sizeof(CacheHeader);
+  hdr.data_offset =
+      ((hdr.names_offset + names_blob.size() + cache_data_alignment - 1) /
+       cache_data_alignment) *
+      cache_data_alignment;
+
+  size_t ntotcols = hdr.ncols + nnorm_cols;
+  size_t file_size = hdr.data_offset + ntotcols * nrows * sizeof(double);
+
+  auto outpath = path;
+  outpath += fmt::format(".cols.{}", ::getpid());
+  int fd = ::open(outpath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if ((fd < 0) || (::ftruncate(fd, file_size) != 0)) {
+    log_critical("Failed to create EventFrame cache file {}",
+                 outpath.native());
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw EventFrameCacheIOError() << outpath.native();
+  }
+  void *map =
+      ::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    log_critical("Failed to map EventFrame cache file {}", outpath.native());
+    throw EventFrameCacheIOError() << outpath.native();
+  }
+
+  auto base = static_cast<char *>(map);
+  std::memcpy(base, &hdr, sizeof(hdr));
+  std::memcpy(base + hdr.names_offset, names_blob.data(), names_blob.size());
+
+  // transpose the row-wise temporary file into contiguous columns
+  auto cols = reinterpret_cast<double *>(base + hdr.data_offset);
+  std::ifstream rows(tmppath, std::ios::binary);
+  std::vector<double> row(ntotcols);
+  for (size_t i = 0; i < nrows; ++i) {
+    rows.read(reinterpret_cast<char *>(row.data()), ntotcols * sizeof(double));
+    for (size_t j = 0; j < ntotcols; ++j) {
+      cols[j * nrows + i] = row[j];
+    }
+  }
+  bool read_ok = bool(rows);
+  rows.close();
+
+  ::msync(map, file_size, MS_SYNC);
+  ::munmap(map, file_size);
+
+  std::filesystem::remove(tmppath);
+  finalized = true;
+
+  if (!read_ok) {
+    std::filesystem::remove(outpath);
+    log_critical("Failed to read back EventFrame cache temporary file {}",
+                 tmppath.native());
+    throw EventFrameCacheIOError() << tmppath.native();
+  }
+
+  std::filesystem::rename(outpath, path);
+  log_info("Wrote EventFrame cache {} with {} rows.", path.native(), nrows);
+}
+
+EventFrameCacheWriter::~EventFrameCacheWriter() {
+  if (!finalized) {
+    tmp.close();
+    std::error_code ec;
+    std::filesystem::remove(tmppath, ec);
+  }
+}
+
+EventFrameCacheReader::EventFrameCacheReader()
+    : fd{-1}, map{nullptr}, map_size{0}, nrows{0}, final_norm_info{0, 0, 0},
+      data{nullptr} {}
+
+std::shared_ptr<EventFrameCacheReader>
+EventFrameCacheReader::open(std::filesystem::path const &path, uint64_t key) {
+  if (!std::filesystem::exists(path)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<EventFrameCacheReader> rdr(new EventFrameCacheReader());
+
+  rdr->fd = ::open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if ((rdr->fd < 0) || (::fstat(rdr->fd, &st) != 0) ||
+      (size_t(st.st_size) < sizeof(CacheHeader))) {
+    log_warn("Ignoring unreadable EventFrame cache file {}", path.native());
+    return nullptr;
+  }
+  rdr->map_size = st.st_size;
+  rdr->map = ::mmap(nullptr, rdr->map_size, PROT_READ, MAP_SHARED, rdr->fd, 0);
+  if (rdr->map == MAP_FAILED) {
+    rdr->map = nullptr;
+    log_warn("Failed to map EventFrame cache file {}", path.native());
+    return nullptr;
+  }
+
+  auto base = static_cast<char const *>(rdr->map);
+  CacheHeader hdr;
+  std::memcpy(&hdr, base, sizeof(hdr));
+
+  if (std::memcmp(hdr.magic, cache_magic, sizeof(cache_magic)) ||
+      (hdr.version != cache_version) || (hdr.key != key) ||
+      (hdr.data_offset % cache_data_alignment) ||
+      (hdr.data_offset > rdr->map_size) ||
+      ((rdr->map_size - hdr.data_offset) <
+       ((hdr.ncols + nnorm_cols) * hdr.nrows * sizeof(double)))) {
+    log_warn("Ignoring invalid or stale EventFrame cache file {}",
+             path.native());
+    return nullptr;
+  }
+
+  size_t offset = hdr.names_offset;
+  for (size_t j = 0; j < hdr.ncols; ++j) {
+    int64_t typenum;
+    uint64_t len;
+    if ((offset + sizeof(typenum) + sizeof(len)) > hdr.data_offset) {
+      log_warn("Ignoring corrupt EventFrame cache file {}", path.native());
+      return nullptr;
+    }
+    std::memcpy(&typenum, base + offset, sizeof(typenum));
+    offset += sizeof(typenum);
+    std::memcpy(&len, base + offset, sizeof(len));
+    offset += sizeof(len);
+    if ((offset + len) > hdr.data_offset) {
+      log_warn("Ignoring corrupt EventFrame cache file {}", path.native());
+      return nullptr;
+    }
+    rdr->column_types.push_back(int(typenum));
+    rdr->column_names.emplace_back(base + offset, len);
+    offset += len;
+  }
+
+  rdr->nrows = hdr.nrows;
+  rdr->final_norm_info = {hdr.fatx, hdr.sumweights, hdr.nevents};
+  rdr->data = reinterpret_cast<double const *>(base + hdr.data_offset);
+
+  return rdr;
+}
+
+NormInfo EventFrameCacheReader::row_norm_info(size_t i) const {
+  size_t ncols = column_names.size();
+  return {column(ncols)[i], column(ncols + 1)[i],
+          size_t(column(ncols + 2)[i])};
+}
+
+EventFrameCacheReader::~EventFrameCacheReader() {
+  if (map) {
+    ::munmap(map, map_size);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+} // namespace nuis
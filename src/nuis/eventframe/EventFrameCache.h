@@ -0,0 +1,97 @@
+#pragma once
+
+#include "nuis/eventframe/EventFrame.h"
+
+#include "nuis/log.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace nuis {
+
+NEW_NUISANCE_EXCEPT(EventFrameCacheIOError);
+
+// 64 bit FNV-1a, continuing from seed
+uint64_t fnv1a64(void const *data, size_t size,
+                 uint64_t seed = 0xcbf29ce484222325ULL);
+inline uint64_t fnv1a64(std::string_view sv,
+                        uint64_t seed = 0xcbf29ce484222325ULL) {
+  return fnv1a64(sv.data(), sv.size(), seed);
+}
+
+// A cheap identity hash of a set of input files built from their canonical
+// paths, sizes, and last modification times. Does not read the file contents.
+uint64_t hash_input_files(std::vector<std::filesystem::path> const &paths);
+
+// Streams EventFrame chunks to a temporary row-wise file and, on finalize,
+// transposes them into a columnar cache file that is moved into place
+// atomically. If finalize is never called, e.g. because the loop over the
+// input was abandoned, the temporary file is removed and no cache is written.
+class EventFrameCacheWriter : public nuis_named_log("EventFrame") {
+  std::filesystem::path path;
+  std::filesystem::path tmppath;
+  uint64_t key;
+  std::vector<std::string> column_names;
+  std::vector<int> column_types;
+
+  std::ofstream tmp;
+  size_t nrows;
+  bool finalized;
+
+public:
+  EventFrameCacheWriter(std::filesystem::path const &path, uint64_t key,
+                        std::vector<std::string> const &column_names,
+                        std::vector<int> const &column_types);
+
+  // row_norm_infos holds the normalization state when each row's event was
+  // read, it must have one entry per row of frame
+  void append(EventFrame const &frame,
+              std::vector<NormInfo> const &row_norm_infos);
+  void finalize(NormInfo const &norm_info);
+
+  ~EventFrameCacheWriter();
+};
+
+// A read-only, memory-mapped, view of a columnar cache file written by
+// EventFrameCacheWriter.
+class EventFrameCacheReader : public nuis_named_log("EventFrame") {
+  int fd;
+  void *map;
+  size_t map_size;
+
+  std::vector<std::string> column_names;
+  std::vector<int> column_types;
+  size_t nrows;
+  NormInfo final_norm_info;
+
+  double const *data;
+
+  EventFrameCacheReader();
+
+public:
+  // Returns nullptr if path does not exist or is not a valid cache file with
+  // the given key
+  static std::shared_ptr<EventFrameCacheReader>
+  open(std::filesystem::path const &path, uint64_t key);
+
+  size_t num_rows() const { return nrows; }
+  std::vector<std::string> const &get_column_names() const {
+    return column_names;
+  }
+  std::vector<int> const &get_column_types() const { return column_types; }
+
+  // A contiguous column of the cache
+  double const *column(size_t i) const { return data + i * nrows; }
+  // The normalization state when the event for row i was read
+  NormInfo row_norm_info(size_t i) const;
+  // The normalization state after the whole input was processed
+  NormInfo norm_info() const { return final_norm_info; }
+
+  EventFrameCacheReader(EventFrameCacheReader const &) = delete;
+  EventFrameCacheReader &operator=(EventFrameCacheReader const &) = delete;
+  ~EventFrameCacheReader();
+};
+
+} // namespace nuis
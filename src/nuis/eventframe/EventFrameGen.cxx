@@ -1,11 +1,29 @@
 #include "nuis/eventframe/EventFrameGen.h"
 
+#include "nuis/eventinput/EventParticleView.h"
+
 #include "NuHepMC/ReaderUtils.hxx"
 
 #include "fmt/chrono.h"
 
 #include "nuis/log.txx"
 
+#ifdef NUIS_ARROW_ENABLED
+#include "arrow/io/file.h"
+#include "arrow/ipc/writer.h"
+#include "arrow/util/compression.h"
+#endif
+
+#ifdef NUIS_PARQUET_ENABLED
+#include "parquet/arrow/writer.h"
+#endif
+
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #define COLUMN_TYPE_ITER                                                       \
   X(bool)                                                                      \
   X(int)                                                                       \
@@ -15,15 +33,27 @@
   X(float)                                                                     \
   X(double)
 
-NEW_NUISANCE_EXCEPT(InvalidFrameColumnType);
-
 namespace nuis {
 
+struct EventFrameGen::EventBatch {
+  size_t seq;
+  std::vector<EventCVWeightPair> events;
+  // the state of the normalization accumulator just after each event was read
+  std::vector<NormInfo> norm_infos;
+  std::vector<bool> selected;
+  EventFrame rows;
+  // the first event that has not yet been committed to an output chunk
+  size_t next_event;
+};
+
 EventFrameGen::EventFrameGen(INormalizedEventSourcePtr evs, size_t block_size)
     : source(evs), chunk_size{block_size},
       max_events_to_loop{std::numeric_limits<size_t>::max()},
       progress_report_every{std::numeric_limits<size_t>::max()},
-      nevents{std::numeric_limits<size_t>::max()}, ev_it(nullptr) {
+      nevents{std::numeric_limits<size_t>::max()}, nthreads{1},
+      thread_batch_size{1000}, typed_storage_enabled{false}, ev_it(nullptr),
+      neventsread{0},
+      cache_input_hash{0}, cache_row{0} {
   auto run_info = evs->first().value().evt->run_info();
   if (run_info && NuHepMC::GC1::SignalsConvention(run_info, "G.C.2")) {
     nevents = NuHepMC::GC2::ReadExposureNEvents(run_info);
@@ -43,6 +73,77 @@ EventFrameGen EventFrameGen::progress(size_t every) {
   set_log_level(log_level::info);
   return *this;
 }
+EventFrameGen EventFrameGen::threads(size_t n, size_t batch_size) {
+  nthreads = n ? n : std::max(1u, std::thread::hardware_concurrency());
+  thread_batch_size = std::max(batch_size, size_t(1));
+  return *this;
+}
+
+EventFrameGen EventFrameGen::typed_storage(bool enable) {
+  typed_storage_enabled = enable;
+  return *this;
+}
+
+EventFrameGen
+EventFrameGen::cache(std::filesystem::path const &dir,
+                     std::vector<std::filesystem::path> const &input_files,
+                     std::string const &projection_id) {
+  cache_dir = dir;
+  cache_input_hash = hash_input_files(input_files);
+  cache_projection_id = projection_id;
+  return *this;
+}
+
+uint64_t EventFrameGen::cache_key() const {
+  uint64_t key = fnv1a64(cache_projection_id, cache_input_hash);
+  for (auto const &cn : all_column_names) {
+    key = fnv1a64(cn, key);
+  }
+  for (auto const &cb : columns) {
+    key = fnv1a64(&cb.typenum, sizeof(cb.typenum), key);
+  }
+  uint64_t nmax = max_events_to_loop;
+  key = fnv1a64(&nmax, sizeof(nmax), key);
+  uint64_t nfilters = filters.size();
+  return fnv1a64(&nfilters, sizeof(nfilters), key);
+}
+
+bool EventFrameGen::open_cache() {
+  // filters only contribute their number to the key, two different selections
+  // would otherwise share a cache
+  if (filters.size() && cache_projection_id.empty()) {
+    log_critical("EventFrameGen::cache with filters set requires a "
+                 "projection_id that identifies them.");
+    throw EventFrameGenCacheMissingProjectionId();
+  }
+
+  auto key = cache_key();
+  auto path = cache_dir / fmt::format("{:016x}.nuisefc", key);
+
+  cache_reader = EventFrameCacheReader::open(path, key);
+  if (cache_reader &&
+      (cache_reader->get_column_names() == all_column_names)) {
+    log_info("EventFrameGen serving {} rows from cache {}",
+             cache_reader->num_rows(), path.native());
+    cache_row = 0;
+    return true;
+  }
+  cache_reader.reset();
+
+  std::vector<int> column_types{column_type<int>::id, column_type<double>::id,
+                                column_type<int>::id};
+  for (auto const &cb : columns) {
+    column_types.insert(column_types.end(), cb.column_names.size(),
+                        cb.typenum);
+  }
+
+  std::filesystem::create_directories(cache_dir);
+  cache_writer = std::make_shared<EventFrameCacheWriter>(
+      path, key, all_column_names, column_types);
+  log_info("EventFrameGen will write cache {} once the input is exhausted.",
+           path.native());
+  return false;
+}
 
 EventFrame EventFrameGen::first(size_t nchunk) {
   all_column_names = std::accumulate(
@@ -55,25 +156,165 @@ EventFrame EventFrameGen::first(size_t nchunk) {
         return cols;
       });
 
+  all_column_index = EventFrame::make_column_index(all_column_names);
+
+  all_column_locations.clear();
+  if (typed_storage_enabled) {
+    std::map<int, EventFrame::column_t> ncols_of_type;
+    auto add_location = [&](int typenum) {
+      all_column_locations.push_back({typenum, ncols_of_type[typenum]++});
+    };
+    add_location(column_type<int>::id);
+    add_location(column_type<double>::id);
+    add_location(column_type<int>::id);
+    for (auto const &cb : columns) {
+      for (size_t i = 0; i < cb.column_names.size(); ++i) {
+        add_location(cb.typenum);
+      }
+    }
+  }
+
   n_total_rows = 0;
   neventsprocessed = 0;
+  neventsread = 0;
+  pending_batches.clear();
+
+  cache_reader.reset();
+  cache_writer.reset();
+  cache_row_norm_infos.clear();
+  if (!cache_dir.empty() && open_cache()) {
+    return next(nchunk);
+  }
+
   ev_it = begin(source);
 
   return next(nchunk);
 }
 
+EventFrame EventFrameGen::new_frame(size_t nrows) const {
+  EventFrame frame{all_column_names, Eigen::ArrayXXd(), nrows, fnorm_info};
+  frame.column_locations = all_column_locations;
+  frame.column_index = all_column_index;
+
+  if (all_column_locations.empty()) {
+    frame.table.resize(nrows, all_column_names.size());
+    return frame;
+  }
+
+  std::map<int, Eigen::Index> ncols_of_type;
+  for (auto const &loc : all_column_locations) {
+    ncols_of_type[loc.typenum]++;
+  }
+
+#define X(t)                                                                   \
+  frame.typed_table<t>().resize(nrows, ncols_of_type[column_type<t>::id]);
+  COLUMN_TYPE_ITER
+#undef X
+
+  return frame;
+}
+
+size_t EventFrameGen::row_size_bytes() const {
+  if (all_column_locations.empty()) {
+    return all_column_names.size() * sizeof(double);
+  }
+
+  size_t size = 0;
+  for (auto const &loc : all_column_locations) {
+    switch (loc.typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id:                                                     \
+    size += sizeof(t);                                                         \
+    break;
+      COLUMN_TYPE_ITER
+#undef X
+    }
+  }
+  return size;
+}
+
 template <typename T>
-size_t EventFrameGen::fill_row_columns(Eigen::ArrayXdRef row,
-                                       HepMC3::GenEvent const &ev,
-                                       size_t proj_index, size_t first_col,
-                                       size_t ncols_to_fill) {
-  auto const &projs = get_proj_functions<T>()[proj_index](ev);
+size_t EventFrameGen::project_into(HepMC3::GenEvent const &ev,
+                                   size_t proj_index, ProjectionRow<T> row) {
+  return std::min(size_t(row.size()),
+                  get_proj_functions<T>()[proj_index](ev, row));
+}
+
+template <typename T>
+void EventFrameGen::fill_row_columns(EventFrame &frame, size_t row,
+                                     HepMC3::GenEvent const &ev,
+                                     size_t proj_index, size_t first_col,
+                                     size_t ncols_to_fill) {
+  if (!ncols_to_fill) {
+    return;
+  }
+
+  // the columns of a block are adjacent in the table that stores them, so
+  // projections can write straight into the output row
+  auto &tab = frame.typed_table<T>();
+  if (!frame.column_locations.empty() || std::is_same_v<T, double>) {
+    ProjectionRow<T> out(&tab(row, frame.column_location(first_col).index),
+                         ncols_to_fill, Eigen::InnerStride<>(tab.rows()));
+    size_t nprojs = project_into<T>(ev, proj_index, out);
+    out.tail(ncols_to_fill - nprojs).setConstant(kMissingDatum<T>);
+    return;
+  }
+
+  // otherwise, the values are widened into the double table
+  static thread_local Eigen::Array<T, Eigen::Dynamic, 1> scratch;
+  scratch.resize(ncols_to_fill);
+  size_t nprojs = project_into<T>(
+      ev, proj_index,
+      ProjectionRow<T>(scratch.data(), ncols_to_fill, Eigen::InnerStride<>(1)));
+  for (size_t i = 0; i < nprojs; ++i) {
+    frame.table(row, first_col + i) = scratch[i];
+  }
+  for (size_t i = nprojs; i < ncols_to_fill; ++i) {
+    frame.table(row, first_col + i) = kMissingDatum<double>;
+  }
+}
+
+void EventFrameGen::fill_row(EventFrame &frame, size_t row,
+                             HepMC3::GenEvent const &ev, double cvw) {
+  if (frame.column_locations.empty()) {
+    frame.table(row, 0) = ev.event_number();
+    frame.table(row, 1) = cvw;
+    frame.table(row, 2) = NuHepMC::ER3::ReadProcessID(ev);
+  } else {
+    frame.int_table(row, frame.column_locations[0].index) = ev.event_number();
+    frame.table(row, frame.column_locations[1].index) = cvw;
+    frame.int_table(row, frame.column_locations[2].index) =
+        NuHepMC::ER3::ReadProcessID(ev);
+  }
+
+  size_t col_id = 3;
+  for (auto &[column_names, typenum, proj_index] : columns) {
+    switch (typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id:                                                     \
+    fill_row_columns<t>(frame, row, ev, proj_index, col_id,                    \
+                        column_names.size());                                  \
+    break;
+
+      COLUMN_TYPE_ITER
+
+#undef X
+    }
 
-  for (size_t i = 0; i < std::min(projs.size(), ncols_to_fill); ++i) {
-    row[first_col++] = projs[i];
+    col_id += column_names.size();
   }
+}
 
-  return first_col;
+// copies row from_row of from into row to_row of to, which must have the same
+// storage layout
+void copy_frame_row(EventFrame const &from, size_t from_row, EventFrame &to,
+                    size_t to_row) {
+#define X(t)                                                                   \
+  if (from.typed_table<t>().cols()) {                                          \
+    to.typed_table<t>().row(to_row) = from.typed_table<t>().row(from_row);     \
+  }
+  COLUMN_TYPE_ITER
+#undef X
 }
 
 EventFrame EventFrameGen::next(size_t nchunk) {
@@ -82,16 +323,71 @@ EventFrame EventFrameGen::next(size_t nchunk) {
     nchunk = chunk_size;
   }
 
+  if (cache_reader) {
+    return next_cached(nchunk);
+  }
+
+  auto frame = next_uncached(nchunk);
+
+  if (cache_writer) {
+    cache_writer->append(frame, cache_row_norm_infos);
+    cache_row_norm_infos.clear();
+    // a short chunk means that the input has been exhausted
+    if (frame.num_rows < nchunk) {
+      cache_writer->finalize(fnorm_info);
+      cache_writer.reset();
+    }
+  }
+
+  return frame;
+}
+
+EventFrame EventFrameGen::next_cached(size_t nchunk) {
+  auto frame =
+      new_frame(std::min(nchunk, cache_reader->num_rows() - cache_row));
+
+  for (size_t cid = 0; cid < all_column_names.size(); ++cid) {
+    Eigen::Map<Eigen::ArrayXd const> cache_col(
+        cache_reader->column(cid) + cache_row, frame.num_rows);
+    auto loc = frame.column_location(cid);
+    switch (loc.typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id: {                                                   \
+    frame.typed_table<t>().col(loc.index) = cache_col.unaryExpr(               \
+        [](double v) { return narrow_column_value<t>(v); });                   \
+    break;                                                                     \
+  }
+      COLUMN_TYPE_ITER
+#undef X
+    }
+  }
+
+  cache_row += frame.num_rows;
+  n_total_rows += frame.num_rows;
+
+  // matches the normalization reported when reading from the input
+  fnorm_info = (frame.num_rows < nchunk)
+                   ? cache_reader->norm_info()
+                   : cache_reader->row_norm_info(cache_row - 1);
+  frame.norm_info = fnorm_info;
+  return frame;
+}
+
+EventFrame EventFrameGen::next_uncached(size_t nchunk) {
+
   log_trace(
       "EventFrameGen::next() neventsprocessed: {}, max_events_to_loop: {}",
       neventsprocessed, max_events_to_loop);
 
   if (neventsprocessed >= max_events_to_loop) {
-    return {all_column_names, Eigen::ArrayXXd(0, all_column_names.size()), 0,
-            fnorm_info};
+    return new_frame(0);
   }
 
-  Eigen::ArrayXXd chunk(nchunk, all_column_names.size());
+  if (nthreads > 1) {
+    return next_threaded(nchunk);
+  }
+
+  auto chunk = new_frame(nchunk);
 
   size_t chunk_row = 0;
 
@@ -118,6 +414,9 @@ EventFrame EventFrameGen::next(size_t nchunk) {
       nuis::StopTalking();
     }
 
+    // shared by the filters and projections for this event
+    EventParticleView::Scope view_scope(ev);
+
     bool cut = false;
     for (auto &filt : filters) {
       if (!filt(ev)) {
@@ -137,34 +436,13 @@ EventFrame EventFrameGen::next(size_t nchunk) {
       continue;
     }
 
-    chunk(chunk_row, 0) = ev.event_number();
-    chunk(chunk_row, 1) = cvw;
-    chunk(chunk_row, 2) = NuHepMC::ER3::ReadProcessID(ev);
-
     NUIS_LOG_TRACE(
         "EventFrameGen::next() chunk_row: {} was kept, event_number: {} ",
         ev.event_number());
 
-    size_t col_id = 3;
-    for (auto &[column_names, typenum, proj_index] : columns) {
-      size_t next_col_id = col_id;
-
-      switch (typenum) {
-#define X(t)                                                                   \
-  case column_type<t>::id:                                                     \
-    next_col_id = fill_row_columns<t>(chunk.row(chunk_row), ev, proj_index,    \
-                                      col_id, column_names.size());            \
-    break;
-
-        COLUMN_TYPE_ITER
-
-#undef X
-      }
-
-      for (size_t i = next_col_id; i < (col_id + column_names.size()); ++i) {
-        chunk(chunk_row, i) = kMissingDatum<double>;
-      }
-      col_id += column_names.size();
+    fill_row(chunk, chunk_row, ev, cvw);
+    if (cache_writer) {
+      cache_row_norm_infos.push_back(source->norm_info());
     }
 
     n_total_rows++;
@@ -192,88 +470,387 @@ EventFrame EventFrameGen::next(size_t nchunk) {
   fnorm_info = source->norm_info();
   ++ev_it;
 
-  return {all_column_names, chunk.topRows(chunk_row), chunk_row, fnorm_info};
+  chunk.conservative_resize(chunk_row);
+  chunk.norm_info = fnorm_info;
+  return chunk;
+}
+
+void EventFrameGen::process_batch(EventBatch &batch) {
+  batch.selected.assign(batch.events.size(), false);
+  batch.rows = new_frame(batch.events.size());
+
+  for (size_t i = 0; i < batch.events.size(); ++i) {
+    auto const &[evp, cvw] = batch.events[i];
+    auto const &ev = *evp;
+    EventParticleView::Scope view_scope(ev);
+
+    bool cut = false;
+    for (auto &filt : filters) {
+      if (!filt(ev)) {
+        cut = true;
+        break;
+      }
+    }
+    if (cut) {
+      continue;
+    }
+
+    batch.selected[i] = true;
+    fill_row(batch.rows, i, ev, cvw);
+  }
+}
+
+void EventFrameGen::commit_batch(EventBatch &batch, EventFrame &chunk,
+                                 size_t &chunk_row) {
+  auto nmaxloop = std::min(max_events_to_loop, nevents);
+
+  for (; (batch.next_event < batch.events.size()) &&
+         (chunk_row < chunk.num_rows);
+       ++batch.next_event) {
+
+    if (neventsprocessed && progress_report_every &&
+        !(neventsprocessed % progress_report_every)) {
+      nuis::StartTalking();
+      log_info("EventFrameGen has selected {}{} from {} processed events.",
+               n_total_rows,
+               ((nmaxloop != std::numeric_limits<size_t>::max())
+                    ? fmt::format("/{}", nmaxloop)
+                    : ""),
+               neventsprocessed);
+      nuis::StopTalking();
+    }
+
+    if (batch.selected[batch.next_event]) {
+      copy_frame_row(batch.rows, batch.next_event, chunk, chunk_row++);
+      n_total_rows++;
+      if (cache_writer) {
+        cache_row_norm_infos.push_back(batch.norm_infos[batch.next_event]);
+      }
+    }
+    neventsprocessed++;
+    fnorm_info = batch.norm_infos[batch.next_event];
+  }
+}
+
+EventFrame EventFrameGen::next_threaded(size_t nchunk) {
+
+  auto chunk = new_frame(nchunk);
+  size_t chunk_row = 0;
+  size_t neventsprocessed_at_start = neventsprocessed;
+
+  // as for the serial loop, only the progress reports in commit_batch talk
+  nuis::StopTalking();
+
+  // rows left over from the last call come first
+  while (pending_batches.size() && (chunk_row < nchunk)) {
+    commit_batch(*pending_batches.front(), chunk, chunk_row);
+    if (pending_batches.front()->next_event ==
+        pending_batches.front()->events.size()) {
+      pending_batches.pop_front();
+    }
+  }
+
+  if ((chunk_row < nchunk) && (neventsread < max_events_to_loop) &&
+      (ev_it != end(source))) {
+
+    std::mutex mtx;
+    std::condition_variable cv_queue, cv_work, cv_done;
+    std::deque<EventBatchPtr> to_process;
+    std::map<size_t, EventBatchPtr> processed;
+    size_t nbatches_read = 0;
+    bool reading = true;
+    bool stop = false;
+    std::exception_ptr err = nullptr;
+    size_t const max_queued = 2 * nthreads;
+
+    // the event source is not thread safe, so all reading and normalization
+    // accounting happens on this thread
+    std::thread reader([&]() {
+      try {
+        auto end_it = end(source);
+        while (true) {
+          auto batch = std::make_shared<EventBatch>();
+          batch->next_event = 0;
+          batch->events.reserve(thread_batch_size);
+          batch->norm_infos.reserve(thread_batch_size);
+
+          while ((batch->events.size() < thread_batch_size) &&
+                 (neventsread < max_events_to_loop) && (ev_it != end_it)) {
+            batch->events.push_back(*ev_it);
+            batch->norm_infos.push_back(source->norm_info());
+            // have to do this before the next loop otherwise we read one too
+            // many events
+            if (++neventsread >= max_events_to_loop) {
+              break;
+            }
+            ++ev_it;
+          }
+
+          if (!batch->events.size()) {
+            break;
+          }
+
+          std::unique_lock<std::mutex> lk(mtx);
+          cv_queue.wait(
+              lk, [&]() { return stop || (to_process.size() < max_queued); });
+          // events have already been pulled from the source, so this batch
+          // must be processed even if we have been asked to stop
+          batch->seq = nbatches_read++;
+          to_process.push_back(batch);
+          cv_work.notify_one();
+          if (stop) {
+            break;
+          }
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!err) {
+          err = std::current_exception();
+        }
+      }
+      std::lock_guard<std::mutex> lk(mtx);
+      reading = false;
+      cv_work.notify_all();
+      cv_done.notify_all();
+    });
+
+    auto worker = [&]() {
+      while (true) {
+        EventBatchPtr batch = nullptr;
+        {
+          std::unique_lock<std::mutex> lk(mtx);
+          cv_work.wait(lk, [&]() { return to_process.size() || !reading; });
+          if (!to_process.size()) {
+            return;
+          }
+          batch = to_process.front();
+          to_process.pop_front();
+          cv_queue.notify_one();
+        }
+
+        try {
+          process_batch(*batch);
+        } catch (...) {
+          std::lock_guard<std::mutex> lk(mtx);
+          if (!err) {
+            err = std::current_exception();
+          }
+          stop = true;
+          cv_queue.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lk(mtx);
+        processed[batch->seq] = batch;
+        cv_done.notify_all();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < nthreads; ++i) {
+      workers.emplace_back(worker);
+    }
+
+    // commit batches in the order that they were read
+    size_t next_seq = 0;
+    while (true) {
+      EventBatchPtr batch = nullptr;
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv_done.wait(lk, [&]() {
+          return processed.count(next_seq) || err ||
+                 (!reading && (next_seq == nbatches_read));
+        });
+        if (err || !processed.count(next_seq)) {
+          break;
+        }
+        batch = processed[next_seq];
+        processed.erase(next_seq++);
+      }
+
+      commit_batch(*batch, chunk, chunk_row);
+
+      if (batch->next_event < batch->events.size()) {
+        pending_batches.push_back(batch);
+      }
+
+      if (chunk_row >= nchunk) {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+        cv_queue.notify_all();
+        break;
+      }
+    }
+
+    reader.join();
+    for (auto &w : workers) {
+      w.join();
+    }
+
+    if (err) {
+      nuis::StartTalking();
+      std::rethrow_exception(err);
+    }
+
+    // anything read ahead is kept, in order, for the next call
+    for (auto &[seq, batch] : processed) {
+      pending_batches.push_back(batch);
+    }
+  }
+  nuis::StartTalking();
+
+  log_trace("EventFrameGen::next_threaded() done looping  n_total_rows: {} "
+            "neventsprocessed: {} chunk_row: {}",
+            n_total_rows, neventsprocessed, chunk_row);
+
+  if (neventsprocessed == neventsprocessed_at_start) {
+    fnorm_info = source->norm_info();
+  }
+
+  chunk.conservative_resize(chunk_row);
+  chunk.norm_info = fnorm_info;
+  return chunk;
+}
+
+// copies all rows of from into to starting at row to_first_row, the frames
+// must have the same storage layout
+void copy_frame_rows(EventFrame const &from, EventFrame &to,
+                     size_t to_first_row) {
+#define X(t)                                                                   \
+  if (from.typed_table<t>().cols()) {                                          \
+    to.typed_table<t>().middleRows(to_first_row, from.num_rows) =              \
+        from.typed_table<t>();                                                 \
+  }
+  COLUMN_TYPE_ITER
+#undef X
+}
+
+size_t frame_size_bytes(EventFrame const &frame) {
+  size_t size = 0;
+#define X(t) size += frame.typed_table<t>().size() * sizeof(t);
+  COLUMN_TYPE_ITER
+#undef X
+  return size;
+}
+
+size_t EventFrameGen::all_rows_estimate(size_t first_chunk_rows) const {
+  if (cache_reader) {
+    return cache_reader->num_rows();
+  }
+
+  size_t nexpected = std::min(max_events_to_loop, nevents);
+  if ((nexpected == std::numeric_limits<size_t>::max()) || !neventsprocessed ||
+      (neventsprocessed >= nexpected)) {
+    return first_chunk_rows;
+  }
+
+  // assume that the rest of the events pass the filters at the same rate as
+  // those in the first chunk
+  double pass_fraction = double(first_chunk_rows) / double(neventsprocessed);
+  return std::max(first_chunk_rows,
+                  size_t(std::ceil(pass_fraction * double(nexpected))));
 }
 
 EventFrame EventFrameGen::all() {
 
+  auto next_chunk = first();
+
   log_info("EventFrameGen::all Chunk shape: {} rows {} cols, {} KB.",
            chunk_size, all_column_names.size(),
-           ((chunk_size * all_column_names.size()) * sizeof(double)) / 1024);
+           (chunk_size * row_size_bytes()) / 1024);
 
-  Eigen::ArrayXXd builder;
-  Eigen::ArrayXXd next_chunk = first().table;
-  log_trace("EventFrameGen::all() first with nrows {}", builder.rows());
+  log_trace("EventFrameGen::all() first with nrows {}", next_chunk.num_rows);
 
-  size_t last_report_size = 0;
-  if ((neventsprocessed - last_report_size) > progress_report_every) {
-    log_info("EventFrameGen::all() is using ~{} MB of memory. Output "
-             "EventFrame will be {} MB.",
-             ((builder.size() * 2 + next_chunk.size()) * sizeof(double)) /
-                 (1024 * 1024),
-             (builder.size() * sizeof(double)) / (1024 * 1024));
-    last_report_size = builder.rows() + next_chunk.rows();
-  }
+  // Every chunk is copied once into a single output frame. If the estimate
+  // is exact, e.g. without filters and with a G.C.2 exposure, the output is
+  // never reallocated. Otherwise it grows geometrically, so that the total
+  // copying stays linear in the number of rows.
+  size_t capacity = all_rows_estimate(next_chunk.num_rows);
+  auto builder = new_frame(capacity);
+  size_t nrows = 0;
 
-  while (next_chunk.rows()) {
+  log_debug("EventFrameGen::all() preallocated {} rows, {} MB.", capacity,
+            frame_size_bytes(builder) / (1024 * 1024));
+
+  size_t last_report_size = 0;
+  while (next_chunk.num_rows) {
     log_trace("EventFrameGen::all() got chunk with nrows {}",
-              next_chunk.rows());
+              next_chunk.num_rows);
 
-    Eigen::ArrayXXd new_builder(builder.rows() + next_chunk.rows(),
-                                next_chunk.cols());
-    new_builder.topRows(builder.rows()) = builder;
-    new_builder.bottomRows(next_chunk.rows()) = next_chunk;
+    if ((nrows + next_chunk.num_rows) > capacity) {
+      capacity = std::max(nrows + next_chunk.num_rows, capacity + capacity / 2);
+      log_debug("EventFrameGen::all() growing output to {} rows.", capacity);
+      builder.conservative_resize(capacity);
+    }
 
-    builder = new_builder;
+    copy_frame_rows(next_chunk, builder, nrows);
+    nrows += next_chunk.num_rows;
 
-    next_chunk = next().table;
+    next_chunk = next();
 
     if ((neventsprocessed - last_report_size) > progress_report_every) {
       log_info("EventFrameGen::all() is using ~{} MB of memory. Output "
-               "EventFrame will be {} MB.",
-               ((builder.size() * 2 + next_chunk.size()) * sizeof(double)) /
+               "EventFrame will be at least {} MB.",
+               (frame_size_bytes(builder) + frame_size_bytes(next_chunk)) /
                    (1024 * 1024),
-               (builder.size() * sizeof(double)) / (1024 * 1024));
-      last_report_size = builder.rows() + next_chunk.rows();
+               (frame_size_bytes(builder) / capacity) * nrows / (1024 * 1024));
+      last_report_size = neventsprocessed;
     }
   }
 
-  log_trace("EventFrameGen::all() done: nrows {}", builder.rows());
+  if (nrows != capacity) {
+    builder.conservative_resize(nrows);
+  }
+
+  log_trace("EventFrameGen::all() done: nrows {}", builder.num_rows);
 
-  return {all_column_names, builder, size_t(builder.rows()),
-          source->norm_info()};
+  builder.norm_info = fnorm_info;
+  return builder;
 }
 
 #ifdef NUIS_ARROW_ENABLED
 
-template <typename T>
-std::pair<std::shared_ptr<arrow::Field>, ArrowBuilderPtr>
-GetColumnBuilder(std::string const &name) {
-  return {arrow::field(name, nuis::column_type<T>::mkt()),
-          nuis::column_type<T>::mkb()};
-}
+struct EventFrameGen::ArrowBatchBuilder {
+  std::shared_ptr<arrow::Schema> schema;
+  std::vector<ArrowBuilderPtr> builders;
+  std::vector<int> typenums;
+  // the number of rows in the current batch that every builder has space for
+  size_t capacity;
+
+  // every builder was made from the column_type of its typenum, so the checked
+  // dynamic_cast is unnecessary
+  template <typename T>
+  typename column_type<T>::ATT::BuilderType &as(size_t col_id) {
+    return *static_cast<typename column_type<T>::ATT::BuilderType *>(
+        builders[col_id].get());
+  }
 
-template <typename T>
-typename nuis::column_type<T>::ATT::BuilderType &
-BuilderAs(ArrowBuilderPtr &ab) {
-  return *dynamic_cast<typename nuis::column_type<T>::ATT::BuilderType *>(
-      ab.get());
-}
+  arrow::Status reserve(size_t nrows) {
+    for (auto &b : builders) {
+      ARROW_RETURN_NOT_OK(b->Reserve(nrows));
+    }
+    capacity += nrows;
+    return arrow::Status::OK();
+  }
+};
 
 template <typename T>
-void EventFrameGen::fill_array_builder(
-    std::vector<ArrowBuilderPtr> &array_builders, HepMC3::GenEvent const &ev,
-    size_t proj_index, size_t first_col, size_t ncols_to_fill) {
+void EventFrameGen::fill_array_builder(ArrowBatchBuilder &ab,
+                                       HepMC3::GenEvent const &ev,
+                                       size_t proj_index, size_t first_col,
+                                       size_t ncols_to_fill) {
 
-  size_t next_col_id = first_col;
+  static thread_local Eigen::Array<T, Eigen::Dynamic, 1> scratch;
+  scratch.resize(ncols_to_fill);
+  size_t nprojs = project_into<T>(
+      ev, proj_index,
+      ProjectionRow<T>(scratch.data(), ncols_to_fill, Eigen::InnerStride<>(1)));
 
-  auto const &projs = get_proj_functions<T>()[proj_index](ev);
-  for (size_t i = 0; i < std::min(projs.size(), ncols_to_fill); ++i) {
-    BuilderAs<T>(array_builders[next_col_id++]).Append(projs[i]);
+  // space for this row has already been reserved in every builder
+  for (size_t i = 0; i < nprojs; ++i) {
+    ab.as<T>(first_col + i).UnsafeAppend(scratch[i]);
   }
-
-  for (size_t i = next_col_id; i < (first_col + ncols_to_fill); ++i) {
-    BuilderAs<T>(array_builders[i]).Append(kMissingDatum<T>);
+  for (size_t i = nprojs; i < ncols_to_fill; ++i) {
+    ab.as<T>(first_col + i).UnsafeAppend(kMissingDatum<T>);
   }
 }
 
@@ -291,73 +868,88 @@ std::shared_ptr<arrow::RecordBatch> EventFrameGen::firstArrow(size_t nchunk) {
 
   n_total_rows = 0;
   neventsprocessed = 0;
+  neventsread = 0;
+  pending_batches.clear();
   ev_it = begin(source);
 
-  return _nextArrow(nchunk).ValueOrDie();
-}
-
-arrow::Result<std::shared_ptr<arrow::RecordBatch>>
-EventFrameGen::_nextArrow(size_t nchunk) {
-
-  if (nchunk == std::numeric_limits<size_t>::max()) {
-    nchunk = chunk_size;
+  if (nthreads > 1) {
+    log_warn("EventFrameGen::firstArrow does not yet support threaded "
+             "processing, events will be processed serially.");
+  }
+  if (!cache_dir.empty()) {
+    log_warn("EventFrameGen::firstArrow does not yet support caching, events "
+             "will be read from the input.");
   }
 
-  log_trace(
-      "EventFrameGen::nextArrow() neventsprocessed: {}, max_events_to_loop: {}",
-      neventsprocessed, max_events_to_loop);
+  arrow_builder = std::make_shared<ArrowBatchBuilder>();
+  arrow_builder->capacity = 0;
 
-  if (neventsprocessed >= max_events_to_loop) {
-    return arrow::Result(nullptr);
+  std::vector<int> typenums = {
+      nuis::column_type<int>::id, nuis::column_type<double>::id,
+      nuis::column_type<int>::id, nuis::column_type<double>::id};
+  for (auto &[column_names, typenum, proj_index] : columns) {
+    typenums.insert(typenums.end(), column_names.size(), typenum);
   }
 
-  std::vector<std::shared_ptr<arrow::Field>> schema_list;
-  std::vector<ArrowBuilderPtr> array_builders;
-
-  log_debug("EventFrameGen::nextArrow() Building schema: ");
+  log_debug("EventFrameGen::firstArrow() Building schema: ");
 
-  for (auto const &[name, typenum] : std::vector<std::pair<std::string, int>>{
-           {"event.number", nuis::column_type<int>::id},
-           {"weight.cv", nuis::column_type<double>::id},
-           {"process.id", nuis::column_type<int>::id},
-           {"fatx.estimate", nuis::column_type<double>::id}}) {
+  std::vector<std::shared_ptr<arrow::Field>> schema_list;
+  for (size_t col_id = 0; col_id < all_column_names.size(); ++col_id) {
+    auto const &name = all_column_names[col_id];
+    auto typenum = typenums[col_id];
 
     std::shared_ptr<arrow::Field> col = nullptr;
     ArrowBuilderPtr builder = nullptr;
 
-    log_debug("\t\t col: {}, name: {}, type: {}", schema_list.size(), name,
-              column_typenum_as_string(typenum));
-
 #define X(t)                                                                   \
   if (typenum == nuis::column_type<t>::id) {                                   \
-    std::tie(col, builder) = GetColumnBuilder<t>(name);                        \
+    col = arrow::field(name, nuis::column_type<t>::mkt());                     \
+    builder = nuis::column_type<t>::mkb();                                     \
   } else
 
     COLUMN_TYPE_ITER { throw InvalidFrameColumnType(); };
+#undef X
+
+    log_debug("\t\t col: {}, name: {}, type: {}, field: {}, array_builder: {}",
+              col_id, name, column_typenum_as_string(typenum),
+              static_cast<void *>(col.get()),
+              static_cast<void *>(builder.get()));
 
     schema_list.push_back(std::move(col));
-    array_builders.push_back(std::move(builder));
+    arrow_builder->builders.push_back(std::move(builder));
   }
+  arrow_builder->schema = std::make_shared<arrow::Schema>(schema_list);
+  arrow_builder->typenums = std::move(typenums);
 
-  for (auto &[column_names, typenum, proj_index] : columns) {
-    for (auto const &name : column_names) {
-      std::shared_ptr<arrow::Field> col = nullptr;
-      ArrowBuilderPtr builder = nullptr;
+  return _nextArrow(nchunk).ValueOrDie();
+}
 
-      COLUMN_TYPE_ITER { throw InvalidFrameColumnType(); };
-#undef X
+std::shared_ptr<arrow::Schema> EventFrameGen::arrow_schema() const {
+  return arrow_builder ? arrow_builder->schema : nullptr;
+}
 
-      log_debug(
-          "\t\t col: {}, name: {}, type: {}, field: {}, array_builder: {}",
-          schema_list.size(), name, column_typenum_as_string(typenum),
-          static_cast<void *>(col.get()), static_cast<void *>(builder.get()));
+arrow::Result<std::shared_ptr<arrow::RecordBatch>>
+EventFrameGen::_nextArrow(size_t nchunk) {
 
-      schema_list.push_back(std::move(col));
-      array_builders.push_back(std::move(builder));
-    }
+  if (nchunk == std::numeric_limits<size_t>::max()) {
+    nchunk = chunk_size;
+  }
+
+  log_trace(
+      "EventFrameGen::nextArrow() neventsprocessed: {}, max_events_to_loop: {}",
+      neventsprocessed, max_events_to_loop);
+
+  if (!arrow_builder) {
+    return arrow::Status::Invalid(
+        "EventFrameGen::nextArrow() called before firstArrow().");
   }
 
-  auto schema = std::make_shared<arrow::Schema>(schema_list);
+  if (neventsprocessed >= max_events_to_loop) {
+    return arrow::Result(nullptr);
+  }
+
+  auto &ab = *arrow_builder;
+  ab.capacity = 0;
 
   size_t rbatch_row = 0;
   auto end_it = end(source);
@@ -379,6 +971,8 @@ EventFrameGen::_nextArrow(size_t nchunk) {
                neventsprocessed);
     }
 
+    EventParticleView::Scope view_scope(ev);
+
     bool cut = false;
     for (auto &filt : filters) {
       if (!filt(ev)) {
@@ -402,12 +996,19 @@ EventFrameGen::_nextArrow(size_t nchunk) {
         "EventFrameGen::nextArrow() rbatch_row: {} was kept, event_number: {} ",
         ev.event_number());
 
-    BuilderAs<int>(array_builders[0]).Append(ev.event_number());
-    BuilderAs<double>(array_builders[1]).Append(cvw);
-    BuilderAs<int>(array_builders[2]).Append(NuHepMC::ER3::ReadProcessID(ev));
+    // grow every builder in steps of at most chunk_size rows so that a very
+    // large nchunk does not reserve more memory than is ever used
+    if (rbatch_row == ab.capacity) {
+      ARROW_RETURN_NOT_OK(ab.reserve(
+          std::max(size_t(1), std::min(nchunk - rbatch_row, chunk_size))));
+    }
+
+    ab.as<int>(0).UnsafeAppend(ev.event_number());
+    ab.as<double>(1).UnsafeAppend(cvw);
+    ab.as<int>(2).UnsafeAppend(NuHepMC::ER3::ReadProcessID(ev));
 
     auto [fatx, sumweights, nevents] = source->norm_info();
-    BuilderAs<double>(array_builders[3]).Append(fatx);
+    ab.as<double>(3).UnsafeAppend(fatx);
 
     size_t col_id = 4;
     for (auto &[column_names, typenum, proj_index] : columns) {
@@ -416,8 +1017,7 @@ EventFrameGen::_nextArrow(size_t nchunk) {
 
 #define X(t)                                                                   \
   case column_type<t>::id:                                                     \
-    fill_array_builder<t>(array_builders, ev, proj_index, col_id,              \
-                          column_names.size());                                \
+    fill_array_builder<t>(ab, ev, proj_index, col_id, column_names.size());    \
     break;
 
         COLUMN_TYPE_ITER
@@ -451,60 +1051,156 @@ EventFrameGen::_nextArrow(size_t nchunk) {
   fnorm_info = source->norm_info();
   ++ev_it;
 
-  std::vector<std::shared_ptr<arrow::Array>> arrays(all_column_names.size(),
+  // Finish hands the built buffers over to the arrays and resets each builder
+  // so that it can be reused for the next batch
+  std::vector<std::shared_ptr<arrow::Array>> arrays(ab.builders.size(),
                                                     nullptr);
-  ARROW_ASSIGN_OR_RAISE(arrays[0], BuilderAs<int>(array_builders[0]).Finish());
-  ARROW_ASSIGN_OR_RAISE(arrays[1],
-                        BuilderAs<double>(array_builders[1]).Finish());
-  ARROW_ASSIGN_OR_RAISE(arrays[2], BuilderAs<int>(array_builders[2]).Finish());
-  ARROW_ASSIGN_OR_RAISE(arrays[3],
-                        BuilderAs<double>(array_builders[3]).Finish());
   log_debug("EventFrameGen::nextArrow() building arrays: ");
-  log_debug("\t\t col: {}, name: {}, type: {}, num: {}", 0, all_column_names[0],
-            column_typenum_as_string(column_type<int>::id),
-            arrays[0]->length());
-  log_debug("\t\t col: {}, name: {}, type: {}, num: {}", 1, all_column_names[1],
-            column_typenum_as_string(column_type<double>::id),
-            arrays[1]->length());
-  log_debug("\t\t col: {}, name: {}, type: {}, num: {}", 2, all_column_names[2],
-            column_typenum_as_string(column_type<double>::id),
-            arrays[2]->length());
-  log_debug("\t\t col: {}, name: {}, type: {}, num: {}", 3, all_column_names[3],
-            column_typenum_as_string(column_type<double>::id),
-            arrays[3]->length());
-
-  size_t col_id = 4;
-  for (auto &[column_names, typenum, proj_index] : columns) {
+  for (size_t col_id = 0; col_id < ab.builders.size(); ++col_id) {
+    ARROW_ASSIGN_OR_RAISE(arrays[col_id], ab.builders[col_id]->Finish());
+    log_debug("\t\t col: {}, name: {}, type: {}, num: {}", col_id,
+              all_column_names[col_id],
+              column_typenum_as_string(ab.typenums[col_id]),
+              arrays[col_id]->length());
+  }
 
-    switch (typenum) {
-#define X(t)                                                                   \
-  case column_type<t>::id:                                                     \
-    for (size_t i = 0; i < column_names.size(); ++i) {                         \
-      ARROW_ASSIGN_OR_RAISE(                                                   \
-          arrays[col_id + i],                                                  \
-          BuilderAs<t>(array_builders[col_id + i]).Finish());                  \
-    }                                                                          \
-    break;
+  return arrow::Result(
+      arrow::RecordBatch::Make(ab.schema, rbatch_row, arrays));
+}
 
-      COLUMN_TYPE_ITER
-#undef X
+std::shared_ptr<arrow::RecordBatch> EventFrameGen::nextArrow(size_t nchunk) {
+  return _nextArrow(nchunk).ValueOrDie();
+}
+
+std::shared_ptr<arrow::KeyValueMetadata>
+norm_info_to_arrow_metadata(NormInfo const &ni) {
+  return arrow::key_value_metadata(
+      {"nuis.norm_info.fatx", "nuis.norm_info.sumweights",
+       "nuis.norm_info.nevents"},
+      {fmt::format("{}", ni.fatx), fmt::format("{}", ni.sumweights),
+       fmt::format("{}", ni.nevents)});
+}
+
+NormInfo norm_info_from_arrow_metadata(arrow::KeyValueMetadata const &md) {
+  auto get = [&](std::string const &key) {
+    auto v = md.Get(key);
+    if (!v.ok()) {
+      throw EventFrameWriteError()
+          << "[norm_info_from_arrow_metadata]: metadata has no entry " << key
+          << ".\n------\nMetadata: " << md.ToString();
     }
+    return v.ValueOrDie();
+  };
+  return NormInfo{std::stod(get("nuis.norm_info.fatx")),
+                  std::stod(get("nuis.norm_info.sumweights")),
+                  std::stoul(get("nuis.norm_info.nevents"))};
+}
+
+namespace {
+template <typename T> T value_or_throw(arrow::Result<T> res) {
+  if (!res.ok()) {
+    throw EventFrameWriteError() << res.status().ToString();
+  }
+  return res.MoveValueUnsafe();
+}
+void ok_or_throw(arrow::Status const &status) {
+  if (!status.ok()) {
+    throw EventFrameWriteError() << status.ToString();
+  }
+}
 
-    for (size_t i = 0; i < column_names.size(); ++i) {
-      log_debug("\t\t col: {}, name: {}, type: {}, num: {}", col_id + i,
-                all_column_names[col_id + i], column_typenum_as_string(typenum),
-                arrays[col_id + i]->length());
+// the best general purpose codec that this build of arrow supports
+arrow::Compression::type output_compression() {
+  for (auto codec : {arrow::Compression::ZSTD, arrow::Compression::LZ4_FRAME}) {
+    if (arrow::util::Codec::IsAvailable(codec)) {
+      return codec;
     }
+  }
+  return arrow::Compression::UNCOMPRESSED;
+}
+} // namespace
 
-    col_id += column_names.size();
+void EventFrameGen::write_arrow_ipc(std::filesystem::path const &path,
+                                    size_t nchunk) {
+  auto rb = firstArrow(nchunk);
+
+  auto options = arrow::ipc::IpcWriteOptions::Defaults();
+  auto codec = output_compression();
+  if (codec != arrow::Compression::UNCOMPRESSED) {
+    options.codec = value_or_throw(arrow::util::Codec::Create(codec));
   }
 
-  return arrow::Result(
-      arrow::RecordBatch::Make(schema, arrays.front()->length(), arrays));
+  auto outfile = value_or_throw(arrow::io::FileOutputStream::Open(path));
+  auto writer = value_or_throw(
+      arrow::ipc::MakeFileWriter(outfile, arrow_schema(), options));
+
+  size_t nrows = 0;
+  while (rb && rb->num_rows()) {
+    ok_or_throw(
+        writer->WriteRecordBatch(*rb, norm_info_to_arrow_metadata(fnorm_info)));
+    nrows += rb->num_rows();
+    rb = nextArrow(nchunk);
+  }
+
+  ok_or_throw(writer->Close());
+  ok_or_throw(outfile->Close());
+
+  log_info("EventFrameGen::write_arrow_ipc wrote {} rows to {}.", nrows,
+           path.native());
 }
 
-std::shared_ptr<arrow::RecordBatch> EventFrameGen::nextArrow(size_t nchunk) {
-  return _nextArrow(nchunk).ValueOrDie();
+#ifdef NUIS_PARQUET_ENABLED
+void EventFrameGen::write_parquet(std::filesystem::path const &path,
+                                  size_t row_group_size) {
+  auto rb = firstArrow(row_group_size);
+
+  auto properties = parquet::WriterProperties::Builder()
+                        .max_row_group_length(row_group_size)
+                        ->compression(output_compression())
+                        ->build();
+
+  auto outfile = value_or_throw(arrow::io::FileOutputStream::Open(path));
+  auto writer = value_or_throw(parquet::arrow::FileWriter::Open(
+      *arrow_schema(), arrow::default_memory_pool(), outfile, properties));
+
+  size_t nrows = 0;
+  while (rb && rb->num_rows()) {
+    ok_or_throw(writer->WriteRecordBatch(*rb));
+    nrows += rb->num_rows();
+    rb = nextArrow(row_group_size);
+  }
+
+  ok_or_throw(
+      writer->AddKeyValueMetadata(norm_info_to_arrow_metadata(fnorm_info)));
+  ok_or_throw(writer->Close());
+  ok_or_throw(outfile->Close());
+
+  log_info("EventFrameGen::write_parquet wrote {} rows to {}.", nrows,
+           path.native());
+}
+#endif
+
+EventFrameGenRecordBatchReader::EventFrameGenRecordBatchReader(
+    std::shared_ptr<EventFrameGen> g, size_t nc)
+    : gen(g), nchunk(nc) {
+  next_batch = gen->firstArrow(nchunk);
+  fschema = gen->arrow_schema();
+}
+
+std::shared_ptr<arrow::Schema> EventFrameGenRecordBatchReader::schema() const {
+  return fschema;
+}
+
+arrow::Status EventFrameGenRecordBatchReader::ReadNext(
+    std::shared_ptr<arrow::RecordBatch> *batch) {
+  if (!next_batch || !next_batch->num_rows()) {
+    *batch = nullptr;
+    next_batch = nullptr;
+    return arrow::Status::OK();
+  }
+  *batch = std::move(next_batch);
+  ARROW_ASSIGN_OR_RAISE(next_batch, gen->_nextArrow(nchunk));
+  return arrow::Status::OK();
 }
 
 #endif
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "nuis/eventframe/EventFrame.h"
+#include "nuis/eventframe/EventFrameCache.h"
 #include "nuis/eventframe/column_types.h"
 
 #include "nuis/log.h"
 
+#include <deque>
+#include <filesystem>
 #include <functional>
 #include <numeric>
 
@@ -14,6 +17,24 @@
 
 namespace nuis {
 
+NEW_NUISANCE_EXCEPT(EventFrameGenCacheMissingProjectionId);
+
+#ifdef NUIS_ARROW_ENABLED
+NEW_NUISANCE_EXCEPT(EventFrameWriteError);
+
+// NormInfo is stored alongside written EventFrameGen output as the key-value
+// metadata entries nuis.norm_info.fatx, nuis.norm_info.sumweights, and
+// nuis.norm_info.nevents
+std::shared_ptr<arrow::KeyValueMetadata>
+norm_info_to_arrow_metadata(NormInfo const &ni);
+// Throws EventFrameWriteError if any of the entries are missing
+NormInfo norm_info_from_arrow_metadata(arrow::KeyValueMetadata const &md);
+#endif
+
+#ifdef NUIS_ARROW_ENABLED
+class EventFrameGenRecordBatchReader;
+#endif
+
 class EventFrameGen : public nuis_named_log("EventFrame") {
 
 public:
@@ -25,12 +46,25 @@ public:
   using ProjectionsFunc =
       std::function<std::vector<RT>(HepMC3::GenEvent const &)>;
 
+  // A view of the entries of one output row that a block of columns is
+  // written to, one entry per column name. A ProjectionsIntoFunc returns the
+  // number of leading entries that it wrote, the rest are filled with
+  // kMissingDatum, as for a ProjectionsFunc that returns a short vector.
+  template <typename RT>
+  using ProjectionRow = Eigen::Map<Eigen::Array<RT, Eigen::Dynamic, 1>, 0,
+                                   Eigen::InnerStride<>>;
+  template <typename RT>
+  using ProjectionsIntoFunc =
+      std::function<size_t(HepMC3::GenEvent const &, ProjectionRow<RT>)>;
+
   EventFrameGen(INormalizedEventSourcePtr evs, size_t block_size = 500000);
   EventFrameGen filter(FilterFunc filt);
 
+  // Adds a block of columns that proj writes directly into the output row,
+  // avoiding the std::vector that a ProjectionsFunc allocates for every event.
   template <typename RT>
-  EventFrameGen add_typed_columns(std::vector<std::string> col_names,
-                                  ProjectionsFunc<RT> proj) {
+  EventFrameGen add_typed_columns_into(std::vector<std::string> col_names,
+                                       ProjectionsIntoFunc<RT> proj) {
 
     auto &projs = get_proj_functions<RT>();
     columns.push_back(
@@ -40,20 +74,53 @@ public:
     return *this;
   }
 
+  template <typename RT>
+  EventFrameGen add_typed_columns(std::vector<std::string> col_names,
+                                  ProjectionsFunc<RT> proj) {
+    return add_typed_columns_into<RT>(
+        col_names, [=](auto const &ev, ProjectionRow<RT> row) {
+          auto const &projs = proj(ev);
+          size_t nprojs = std::min(projs.size(), size_t(row.size()));
+          for (size_t i = 0; i < nprojs; ++i) {
+            row[i] = projs[i];
+          }
+          return nprojs;
+        });
+  }
+
   template <typename RT>
   EventFrameGen add_typed_column(std::string col_name,
                                  ProjectionFunc<RT> proj) {
-    add_typed_columns<RT>(
+    return add_typed_columns_into<RT>(
         {
             col_name,
         },
-        [=](auto const &ev) -> std::vector<RT> {
-          return {
-              proj(ev),
-          };
+        [=](auto const &ev, ProjectionRow<RT> row) {
+          row[0] = proj(ev);
+          return size_t(1);
         });
+  }
 
-    return *this;
+  // Adds one column of type RT per callable in projs, all evaluated by a
+  // single type-erased call per event. Pass the callables themselves, e.g.
+  // lambdas, rather than std::functions, so that the compiler can inline them
+  // into one fused kernel.
+  template <typename RT, typename... Projs>
+  EventFrameGen add_fused_columns(std::vector<std::string> col_names,
+                                  Projs... projs) {
+    static_assert(sizeof...(Projs) > 0,
+                  "add_fused_columns requires at least one projection.");
+    if (col_names.size() != sizeof...(Projs)) {
+      throw InvalidFrameColumnName()
+          << "[add_fused_columns]: passed " << col_names.size()
+          << " column names for " << sizeof...(Projs) << " projections.";
+    }
+    return add_typed_columns_into<RT>(
+        col_names, [=](auto const &ev, ProjectionRow<RT> row) {
+          Eigen::Index i = 0;
+          ((row[i++] = projs(ev)), ...);
+          return sizeof...(Projs);
+        });
   }
 
   EventFrameGen add_columns(std::vector<std::string> col_names,
@@ -67,6 +134,32 @@ public:
 
   EventFrameGen limit(size_t nmax);
   EventFrameGen progress(size_t every = 100000);
+  // Evaluate filters and projections on nthreads worker threads. Events are
+  // read serially on a separate reader thread and handed to the workers in
+  // batches of batch_size, rows are always committed in read order. Filters
+  // and projections must be safe to call concurrently. The reader and worker
+  // threads are started by, and joined before returning from, every call to
+  // first/next, so threads only pay off when each chunk spans many batches,
+  // e.g. for all(), or an nchunk that is many times nthreads * batch_size.
+  EventFrameGen threads(size_t nthreads, size_t batch_size = 1000);
+  // Persist the generated frame to a memory-mapped columnar cache file in
+  // cache_dir and, on later runs with the same key, serve first()/next()/all()
+  // from the cache without reading any events. The key is built from the
+  // identity of input_files (path, size, and modification time), the column
+  // names and types, the event limit, the number of filters, and
+  // projection_id. The key cannot see what the filters and projections do, so
+  // projection_id must identify them all, and change whenever the code of any
+  // filter or projection changes. An empty projection_id is refused with
+  // EventFrameGenCacheMissingProjectionId if any filters are set. A cache is
+  // only written once the input has been exhausted by calls to next().
+  EventFrameGen cache(std::filesystem::path const &cache_dir,
+                      std::vector<std::filesystem::path> const &input_files,
+                      std::string const &projection_id);
+  // Store columns natively as their column_type rather than widening every
+  // column to double. event.number and process.id are stored as int. Only
+  // double columns are then accessible through EventFrame::table and
+  // EventFrame::col, use EventFrame::col<T> for the others.
+  EventFrameGen typed_storage(bool enable = true);
 
   EventFrame first(size_t nchunk = std::numeric_limits<size_t>::max());
   EventFrame next(size_t nchunk = std::numeric_limits<size_t>::max());
@@ -79,6 +172,25 @@ public:
       size_t nchunk = std::numeric_limits<size_t>::max());
   std::shared_ptr<arrow::RecordBatch> nextArrow(
       size_t nchunk = std::numeric_limits<size_t>::max());
+  // The schema of the RecordBatches returned by firstArrow/nextArrow. Only
+  // valid after a call to firstArrow.
+  std::shared_ptr<arrow::Schema> arrow_schema() const;
+
+  // Stream every batch from firstArrow/nextArrow to an Arrow IPC file (Feather
+  // V2) at path, without holding more than one batch in memory. The IPC
+  // schema is written before any events are read, so each batch instead
+  // carries the NormInfo accumulated up to and including it as custom
+  // metadata, the last batch holds the NormInfo of the whole sample.
+  void write_arrow_ipc(std::filesystem::path const &path,
+                       size_t nchunk = std::numeric_limits<size_t>::max());
+#ifdef NUIS_PARQUET_ENABLED
+  // Stream every batch from firstArrow/nextArrow to a Parquet file at path
+  // with at most row_group_size rows per row group. The final NormInfo is
+  // stored in the file key-value metadata, which pyarrow exposes as schema
+  // metadata.
+  void write_parquet(std::filesystem::path const &path,
+                     size_t row_group_size = 1024 * 1024);
+#endif
 #endif
 
 private:
@@ -95,7 +207,7 @@ private:
   std::vector<ColumnBlockDefinition> columns;
 
   template <typename RT>
-  constexpr std::vector<ProjectionsFunc<RT>> &get_proj_functions() {
+  constexpr std::vector<ProjectionsIntoFunc<RT>> &get_proj_functions() {
     if constexpr (std::is_same_v<RT, bool>) {
       return projectors_bool;
     } else if constexpr (std::is_same_v<RT, int>) {
@@ -113,41 +225,125 @@ private:
     }
   }
 
+  // an empty frame with nrows rows and the storage layout of the output
+  EventFrame new_frame(size_t nrows) const;
+  // the number of bytes of storage for one row of new_frame
+  size_t row_size_bytes() const;
+  void fill_row(EventFrame &frame, size_t row, HepMC3::GenEvent const &ev,
+                double cvw);
+
+  EventFrame next_uncached(size_t nchunk);
+
+  // the number of rows that all() is expected to return, given the number of
+  // rows in the first chunk
+  size_t all_rows_estimate(size_t first_chunk_rows) const;
+
+  // calls projector proj_index of type T to fill row, returning the number of
+  // entries written
   template <typename T>
-  size_t fill_row_columns(Eigen::ArrayXdRef row, HepMC3::GenEvent const &ev,
-                          size_t proj_index, size_t first_col,
-                          size_t ncols_to_fill);
+  size_t project_into(HepMC3::GenEvent const &ev, size_t proj_index,
+                    ProjectionRow<T> row);
 
-  std::vector<ProjectionsFunc<bool>> projectors_bool;
-  std::vector<ProjectionsFunc<int>> projectors_int;
-  std::vector<ProjectionsFunc<uint>> projectors_uint64_t;
-  std::vector<ProjectionsFunc<int16_t>> projectors_int16_t;
-  std::vector<ProjectionsFunc<uint16_t>> projectors_uint16_t;
-  std::vector<ProjectionsFunc<float>> projectors_float;
-  std::vector<ProjectionsFunc<double>> projectors_double;
+  template <typename T>
+  void fill_row_columns(EventFrame &frame, size_t row,
+                        HepMC3::GenEvent const &ev, size_t proj_index,
+                        size_t first_col, size_t ncols_to_fill);
+
+  std::vector<ProjectionsIntoFunc<bool>> projectors_bool;
+  std::vector<ProjectionsIntoFunc<int>> projectors_int;
+  std::vector<ProjectionsIntoFunc<uint>> projectors_uint64_t;
+  std::vector<ProjectionsIntoFunc<int16_t>> projectors_int16_t;
+  std::vector<ProjectionsIntoFunc<uint16_t>> projectors_uint16_t;
+  std::vector<ProjectionsIntoFunc<float>> projectors_float;
+  std::vector<ProjectionsIntoFunc<double>> projectors_double;
 
 #ifdef NUIS_ARROW_ENABLED
+  friend class EventFrameGenRecordBatchReader;
+
+  // the schema and one ArrayBuilder per column, built once by firstArrow and
+  // reused for every RecordBatch
+  struct ArrowBatchBuilder;
+  std::shared_ptr<ArrowBatchBuilder> arrow_builder;
+
   template <typename T>
-  void fill_array_builder(std::vector<ArrowBuilderPtr> &,
-                          HepMC3::GenEvent const &ev, size_t proj_index,
-                          size_t first_col, size_t ncols_to_fill);
+  void fill_array_builder(ArrowBatchBuilder &, HepMC3::GenEvent const &ev,
+                          size_t proj_index, size_t first_col,
+                          size_t ncols_to_fill);
 
   arrow::Result<std::shared_ptr<arrow::RecordBatch>> _nextArrow(
       size_t nchunk = std::numeric_limits<size_t>::max());
 #endif
 
+  // a block of events read from the source, and the projected rows for those
+  // that pass the filters
+  struct EventBatch;
+  using EventBatchPtr = std::shared_ptr<EventBatch>;
+
+  EventFrame next_threaded(size_t nchunk);
+  void process_batch(EventBatch &batch);
+  void commit_batch(EventBatch &batch, EventFrame &chunk, size_t &chunk_row);
+
   size_t chunk_size;
 
   size_t max_events_to_loop;
   size_t progress_report_every;
   size_t nevents;
+  size_t nthreads;
+  size_t thread_batch_size;
+  bool typed_storage_enabled;
 
   // first/next state
   std::vector<std::string> all_column_names;
+  // empty unless typed_storage is enabled, see EventFrame::column_locations
+  std::vector<EventFrame::ColumnLocation> all_column_locations;
+  std::shared_ptr<EventFrame::ColumnIndex const> all_column_index;
   size_t n_total_rows;
   size_t neventsprocessed;
   INormalizedEventSource_looper ev_it;
   NormInfo fnorm_info;
+
+  // threaded first/next state, events that have been read and projected but
+  // did not fit in the last returned chunk
+  size_t neventsread;
+  std::deque<EventBatchPtr> pending_batches;
+
+  // cache state
+  std::filesystem::path cache_dir;
+  uint64_t cache_input_hash;
+  std::string cache_projection_id;
+
+  uint64_t cache_key() const;
+  bool open_cache();
+  EventFrame next_cached(size_t nchunk);
+
+  std::shared_ptr<EventFrameCacheReader> cache_reader;
+  size_t cache_row;
+  std::shared_ptr<EventFrameCacheWriter> cache_writer;
+  // the normalization state as each row in the current chunk was read
+  std::vector<NormInfo> cache_row_norm_infos;
 };
 
+#ifdef NUIS_ARROW_ENABLED
+// Streams the output of an EventFrameGen as RecordBatches of up to nchunk rows
+// through the standard arrow::RecordBatchReader interface, so that consumers
+// can process a sample batch by batch without materializing all of it. The
+// first batch is read on construction, which restarts the generator. The
+// stream ends at the first empty batch.
+class EventFrameGenRecordBatchReader : public arrow::RecordBatchReader {
+public:
+  EventFrameGenRecordBatchReader(
+      std::shared_ptr<EventFrameGen> gen,
+      size_t nchunk = std::numeric_limits<size_t>::max());
+
+  std::shared_ptr<arrow::Schema> schema() const override;
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override;
+
+private:
+  std::shared_ptr<EventFrameGen> gen;
+  size_t nchunk;
+  std::shared_ptr<arrow::Schema> fschema;
+  std::shared_ptr<arrow::RecordBatch> next_batch;
+};
+#endif
+
 } // namespace nuis
\ No newline at end of file
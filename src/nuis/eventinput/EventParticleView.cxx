@@ -0,0 +1,116 @@
+#include "nuis/eventinput/EventParticleView.h"
+
+#include "NuHepMC/Constants.hxx"
+
+#include <algorithm>
+#include <mutex>
+
+namespace nuis {
+
+namespace {
+thread_local EventParticleView const *current_view = nullptr;
+std::vector<HepMC3::ConstGenParticlePtr> const no_particles;
+} // namespace
+
+EventParticleView::EventParticleView(HepMC3::GenEvent const &e)
+    : ev{&e}, built{false} {}
+
+void EventParticleView::build() const {
+  for (auto const &part : ev->particles()) {
+    switch (part->status()) {
+    case NuHepMC::ParticleStatus::UndecayedPhysical: {
+      fs_parts.push_back(part);
+      fs_parts_by_pid[part->pid()].push_back(part);
+      break;
+    }
+    case NuHepMC::ParticleStatus::IncomingBeam: {
+      if (!beam_part) {
+        beam_part = part;
+      }
+      break;
+    }
+    case NuHepMC::ParticleStatus::Target: {
+      if (!target_part) {
+        target_part = part;
+      }
+      break;
+    }
+    }
+  }
+
+  for (auto &[pid, parts] : fs_parts_by_pid) {
+    std::stable_sort(parts.begin(), parts.end(),
+                     [](auto const &a, auto const &b) {
+                       return a->momentum().p3mod() > b->momentum().p3mod();
+                     });
+  }
+
+  built = true;
+}
+
+HepMC3::ConstGenParticlePtr EventParticleView::beam() const {
+  if (!built) {
+    build();
+  }
+  return beam_part;
+}
+
+HepMC3::ConstGenParticlePtr EventParticleView::target() const {
+  if (!built) {
+    build();
+  }
+  return target_part;
+}
+
+std::vector<HepMC3::ConstGenParticlePtr> const &
+EventParticleView::final_state() const {
+  if (!built) {
+    build();
+  }
+  return fs_parts;
+}
+
+std::vector<HepMC3::ConstGenParticlePtr> const &
+EventParticleView::final_state(int pid) const {
+  if (!built) {
+    build();
+  }
+  auto it = fs_parts_by_pid.find(pid);
+  return (it == fs_parts_by_pid.end()) ? no_particles : it->second;
+}
+
+HepMC3::ConstGenParticlePtr EventParticleView::highest_momentum(int pid) const {
+  auto const &parts = final_state(pid);
+  return parts.size() ? parts.front() : nullptr;
+}
+
+EventParticleView::memo_key_t
+EventParticleView::memo_key(std::string const &name) {
+  static std::mutex keys_mtx;
+  static std::unordered_map<std::string, memo_key_t> keys;
+
+  std::lock_guard lk(keys_mtx);
+  return keys.emplace(name, keys.size()).first->second;
+}
+
+EventParticleView const &
+EventParticleView::current(HepMC3::GenEvent const &ev) {
+  if (!current_view || (&current_view->event() != &ev)) {
+    throw NoEventParticleViewScope()
+        << "EventParticleView::current called for event "
+        << ev.event_number() << " without an open Scope for that event";
+  }
+  return *current_view;
+}
+
+EventParticleView::Scope::Scope(HepMC3::GenEvent const &ev)
+    : owned_view{}, view{current_view}, previous{current_view} {
+  if (!view || (&view->event() != &ev)) {
+    view = &owned_view.emplace(ev);
+  }
+  current_view = view;
+}
+
+EventParticleView::Scope::~Scope() { current_view = previous; }
+
+} // namespace nuis
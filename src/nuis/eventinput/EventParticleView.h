@@ -0,0 +1,103 @@
+#pragma once
+
+#include "nuis/except.h"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nuis {
+
+NEW_NUISANCE_EXCEPT(NoEventParticleViewScope);
+
+// A memoized view of the particles in one event. The particle list is walked
+// once, on the first query, to find the beam and target particles and the real
+// final state particles, which are also grouped by PDG code and sorted by
+// decreasing three-momentum magnitude. The view must not outlive the event.
+//
+// Event loops, e.g. EventFrameGen, open an EventParticleView::Scope for every
+// event before calling any filters or projections, which can then share one
+// view of the event through EventParticleView::current rather than each
+// walking the particle list again.
+class EventParticleView {
+public:
+  explicit EventParticleView(HepMC3::GenEvent const &ev);
+
+  HepMC3::GenEvent const &event() const { return *ev; }
+
+  // nullptr if the event has no such particle
+  HepMC3::ConstGenParticlePtr beam() const;
+  HepMC3::ConstGenParticlePtr target() const;
+
+  std::vector<HepMC3::ConstGenParticlePtr> const &final_state() const;
+  // the final state particles with PDG code pid, highest momentum first
+  std::vector<HepMC3::ConstGenParticlePtr> const &final_state(int pid) const;
+  // nullptr if the final state has no particle with PDG code pid
+  HepMC3::ConstGenParticlePtr highest_momentum(int pid) const;
+
+  using memo_key_t = size_t;
+  // The key for a named per-event quantity, e.g. a ProSelecta selection
+  // function, the same name always gives the same key. Thread-safe, but
+  // intended to be called once when setting up a projection.
+  static memo_key_t memo_key(std::string const &name);
+
+  // The value of f() for the quantity identified by key, f is only called the
+  // first time that key is requested from this view. This lets tables that
+  // share a selection or projection function evaluate it once per event.
+  template <typename F> double memoized(memo_key_t key, F &&f) const {
+    for (auto const &[k, v] : memo) {
+      if (k == key) {
+        return v;
+      }
+    }
+    double v = f();
+    memo.emplace_back(key, v);
+    return v;
+  }
+
+  // The view of ev from the innermost Scope on this thread. Throws
+  // NoEventParticleViewScope if that scope is not for ev, e.g. when a
+  // projection is called outside of an event loop, functions that may be
+  // called outside of a loop should open their own Scope instead.
+  static EventParticleView const &current(HepMC3::GenEvent const &ev);
+
+  class Scope;
+
+private:
+  HepMC3::GenEvent const *ev;
+
+  void build() const;
+
+  mutable bool built;
+  mutable HepMC3::ConstGenParticlePtr beam_part, target_part;
+  mutable std::vector<HepMC3::ConstGenParticlePtr> fs_parts;
+  mutable std::unordered_map<int, std::vector<HepMC3::ConstGenParticlePtr>>
+      fs_parts_by_pid;
+  mutable std::vector<std::pair<memo_key_t, double>> memo;
+};
+
+// Makes a view of ev current on this thread for the lifetime of the scope. If
+// the innermost scope on this thread is already for ev, its view is shared
+// rather than building another. Scopes may be nested, but must be destroyed in
+// the reverse order that they were created.
+class EventParticleView::Scope {
+  std::optional<EventParticleView> owned_view;
+  EventParticleView const *view;
+  EventParticleView const *previous;
+
+public:
+  explicit Scope(HepMC3::GenEvent const &ev);
+  ~Scope();
+
+  Scope(Scope const &) = delete;
+  Scope &operator=(Scope const &) = delete;
+
+  EventParticleView const &get() const { return *view; }
+};
+
+} // namespace nuis
@@ -1,6 +1,7 @@
 #include "nuis/eventinput/EventSourceFactory.h"
 
 #include "nuis/eventinput/HepMC3EventSource.h"
+#include "nuis/eventinput/PrefetchingEventSource.h"
 
 #include "nuis/except.h"
 #include "nuis/log.txx"
@@ -165,8 +166,9 @@ EventSourceFactory::make_unnormalized(YAML::Node cfg) {
 
   // try plugins first as there is a bug in HepMC3 root reader that segfaults
   // if it is not passed the expected type.
-  auto es =
-      std::make_shared<HepMC3EventSource>(cfg["filepath"].as<std::string>());
+  auto es = std::make_shared<HepMC3EventSource>(
+      cfg["filepath"].as<std::string>(),
+      cfg["event_pool_size"] ? cfg["event_pool_size"].as<size_t>() : 0);
   if (es->first()) {
     log_debug("Reading file {} with native HepMC3EventSource",
               cfg["filepath"].as<std::string>());
@@ -187,6 +189,12 @@ EventSourceFactory::make_unnormalized(std::string const &filepath) {
 std::pair<std::shared_ptr<HepMC3::GenRunInfo>, INormalizedEventSourcePtr>
 EventSourceFactory::make(YAML::Node const &cfg) {
   auto [gri, es] = make_unnormalized(cfg);
+  if (es && cfg["prefetch"] && cfg["prefetch"].as<size_t>()) {
+    log_debug("Prefetching up to {} events on a background thread.",
+              cfg["prefetch"].as<size_t>());
+    es = std::make_shared<PrefetchingEventSource>(
+        es, cfg["prefetch"].as<size_t>());
+  }
   auto nes = std::make_shared<INormalizedEventSource>(es);
   if (nes->first()) {
     return {gri, nes};
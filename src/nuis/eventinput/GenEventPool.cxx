@@ -0,0 +1,48 @@
+#include "nuis/eventinput/GenEventPool.h"
+
+namespace nuis {
+
+GenEventPool::GenEventPool(size_t ms)
+    : free_list{std::make_shared<FreeList>()}, max_size{ms}, nallocated{0} {
+  free_list->events.reserve(max_size);
+}
+
+std::shared_ptr<HepMC3::GenEvent>
+GenEventPool::get(HepMC3::Units::MomentumUnit mu, HepMC3::Units::LengthUnit lu) {
+
+  std::unique_ptr<HepMC3::GenEvent> evt;
+  if (max_size) {
+    // the lock orders everything done with a released event before it is
+    // reused here
+    std::lock_guard<std::mutex> lk(free_list->mtx);
+    if (free_list->events.size()) {
+      evt = std::move(free_list->events.back());
+      free_list->events.pop_back();
+    }
+  }
+
+  if (evt) {
+    evt->clear();
+    evt->set_run_info(nullptr);
+    evt->set_units(mu, lu);
+  } else if (nallocated < max_size) {
+    evt = std::make_unique<HepMC3::GenEvent>(mu, lu);
+    nallocated++;
+  } else {
+    // either pooling is disabled or all pooled events are still in use
+    return std::make_shared<HepMC3::GenEvent>(mu, lu);
+  }
+
+  std::weak_ptr<FreeList> wfree_list = free_list;
+  return std::shared_ptr<HepMC3::GenEvent>(
+      evt.release(), [wfree_list](HepMC3::GenEvent *ev) {
+        std::unique_ptr<HepMC3::GenEvent> released(ev);
+        // if the pool has gone, the event is just deleted
+        if (auto fl = wfree_list.lock()) {
+          std::lock_guard<std::mutex> lk(fl->mtx);
+          fl->events.push_back(std::move(released));
+        }
+      });
+}
+
+} // namespace nuis
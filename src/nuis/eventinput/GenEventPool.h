@@ -0,0 +1,46 @@
+#pragma once
+
+#include "HepMC3/GenEvent.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nuis {
+
+// A fixed-size pool of HepMC3::GenEvents for event sources to build events
+// into. Pooled events are handed out with a deleter that, once the last
+// reference to the event is dropped, on whichever thread that happens, returns
+// it to the pool under a lock. The event is only handed out again after that,
+// so users that keep hold of an event, or any other shared pointer to it, are
+// never affected, and events may be released on other threads than the one
+// reading from the source, e.g. with PrefetchingEventSource, fill_tables with
+// nthreads > 1, or EventFrameGen::threads. Recycled events keep the capacity of
+// their internal particle, vertex, and weight containers.
+//
+// get() must only be called from one thread at a time, as event sources are
+// read from a single thread. Events may outlive the pool.
+//
+// A pool of size 0, the default, always allocates a new event.
+class GenEventPool {
+  // shared with the deleters of the events that are handed out
+  struct FreeList {
+    std::mutex mtx;
+    std::vector<std::unique_ptr<HepMC3::GenEvent>> events;
+  };
+  std::shared_ptr<FreeList> free_list;
+  size_t max_size;
+  size_t nallocated;
+
+public:
+  explicit GenEventPool(size_t max_size = 0);
+
+  // Returns an empty event with the requested units
+  std::shared_ptr<HepMC3::GenEvent>
+  get(HepMC3::Units::MomentumUnit mu = HepMC3::Units::GEV,
+      HepMC3::Units::LengthUnit lu = HepMC3::Units::MM);
+
+  size_t size() const { return max_size; }
+};
+
+} // namespace nuis
@@ -3,16 +3,19 @@
 // this is required to enable gzip reading if we built in the support
 #include "NuHepMC/HepMC3Features.hxx"
 
+#include "HepMC3/ReaderAscii.h"
 #include "HepMC3/ReaderFactory.h"
 
 #include "nuis/log.txx"
 
-#include <fstream>
+#include <limits>
 
 namespace nuis {
 
-HepMC3EventSource::HepMC3EventSource(std::filesystem::path const &fp)
-    : filepath(fp){};
+HepMC3EventSource::HepMC3EventSource(std::filesystem::path const &fp,
+                                     size_t event_pool_size)
+    : filepath(fp), nentries{std::numeric_limits<size_t>::max()},
+      pool(event_pool_size) {};
 
 std::shared_ptr<HepMC3::GenEvent> HepMC3EventSource::first() {
 
@@ -33,6 +36,8 @@ std::shared_ptr<HepMC3::GenEvent> HepMC3EventSource::first() {
   }
 
   // reopen the file from the start and get the next event
+  reader.reset();
+  stream.reset();
   reader = HepMC3::deduce_reader(filepath);
   if (!reader || reader->failed()) {
     log_warn("Couldn't deduce reader for {} reader = {}, failed {}",
@@ -48,7 +53,8 @@ std::shared_ptr<HepMC3::GenEvent> HepMC3EventSource::next() {
     return nullptr;
   }
 
-  auto evt = std::make_shared<HepMC3::GenEvent>();
+  // read_event clears the event before filling it
+  auto evt = pool.get();
   reader->read_event(*evt);
   if (reader->failed()) {
     return nullptr;
@@ -58,6 +64,111 @@ std::shared_ptr<HepMC3::GenEvent> HepMC3EventSource::next() {
   return evt;
 }
 
+bool HepMC3EventSource::is_asciiv3() {
+  std::ifstream fin(filepath);
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (!line.size()) {
+      continue;
+    }
+    if (line.rfind("HepMC::Version", 0) != 0) {
+      return false;
+    }
+    return std::getline(fin, line) &&
+           (line.rfind("HepMC::Asciiv3-START_EVENT_LISTING", 0) == 0);
+  }
+  return false;
+}
+
+void HepMC3EventSource::build_index() {
+  if (nentries != std::numeric_limits<size_t>::max()) {
+    return;
+  }
+
+  if (is_asciiv3()) {
+    auto offsets = std::make_shared<std::vector<std::streampos>>();
+
+    std::ifstream fin(filepath);
+    std::string line;
+    auto pos = fin.tellg();
+    while (std::getline(fin, line)) {
+      if ((line.size() > 1) && (line[0] == 'E') && (line[1] == ' ')) {
+        offsets->push_back(pos);
+      }
+      pos = fin.tellg();
+    }
+
+    nentries = offsets->size();
+    event_offsets = offsets;
+    log_debug("HepMC3EventSource indexed {} events in {}", nentries,
+              filepath.native());
+    return;
+  }
+
+  // compressed or non-Asciiv3 input, the only way to count is to read. This
+  // uses a separate source so that the position of this one's reader, which
+  // may be part way through the file, is unaffected
+  log_warn("HepMC3EventSource cannot build a byte offset index for {}, "
+           "counting and seeking will require reading events.",
+           filepath.native());
+  HepMC3EventSource counter(filepath);
+  size_t n = 0;
+  for (auto ev = counter.first(); ev; ev = counter.next()) {
+    ++n;
+  }
+  nentries = n;
+}
+
+size_t HepMC3EventSource::num_entries() {
+  build_index();
+  return nentries;
+}
+
+std::shared_ptr<HepMC3::GenEvent> HepMC3EventSource::seek(size_t i) {
+  build_index();
+
+  if (i >= nentries) {
+    return nullptr;
+  }
+
+  if (!event_offsets) {
+    auto ev = first();
+    if (!ev || !i) {
+      return ev;
+    }
+    if (i > 1) {
+      reader->skip(int(i - 1));
+    }
+    return next();
+  }
+
+  reader.reset();
+  stream = std::make_shared<std::ifstream>(filepath);
+  reader = std::make_shared<HepMC3::ReaderAscii>(*stream);
+
+  // the run info is parsed from the file header as part of reading the first
+  // event, so we always have to read that one
+  auto ev = next();
+  if (!ev || !i) {
+    return ev;
+  }
+
+  stream->clear();
+  stream->seekg((*event_offsets)[i]);
+  return next();
+}
+
+IEventSourcePtr HepMC3EventSource::make_shard(size_t begin, size_t end) {
+  build_index();
+
+  auto shard_source =
+      std::make_shared<HepMC3EventSource>(filepath, pool.size());
+  shard_source->event_offsets = event_offsets;
+  shard_source->nentries = nentries;
+
+  return std::make_shared<RangedEventSourceShard>(shard_source, begin, end);
+}
+
 HepMC3EventSource::~HepMC3EventSource() {}
 
 } // namespace nuis
@@ -1,8 +1,11 @@
 #pragma once
 
-#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/GenEventPool.h"
+#include "nuis/eventinput/IRangedEventSource.h"
 
 #include <filesystem>
+#include <fstream>
+#include <vector>
 
 namespace HepMC3 {
 class Reader;
@@ -10,17 +13,37 @@ class Reader;
 
 namespace nuis {
 
-class HepMC3EventSource : public IEventSource {
+class HepMC3EventSource : public IRangedEventSource {
 
   std::filesystem::path filepath;
+
+  // byte offset of each event record, only built for uncompressed Asciiv3
+  // files. Built on first use and shared with any shards made from this source
+  std::shared_ptr<std::vector<std::streampos> const> event_offsets;
+  size_t nentries;
+
+  // the stream must outlive the reader that is reading from it
+  std::shared_ptr<std::ifstream> stream;
   std::shared_ptr<HepMC3::Reader> reader;
 
+  GenEventPool pool;
+
+  bool is_asciiv3();
+  void build_index();
+
 public:
-  HepMC3EventSource(std::filesystem::path const &fp);
+  // event_pool_size > 0 recycles up to that many GenEvents that are no longer
+  // referenced outside of this source, see GenEventPool
+  HepMC3EventSource(std::filesystem::path const &fp,
+                    size_t event_pool_size = 0);
 
   std::shared_ptr<HepMC3::GenEvent> first();
   std::shared_ptr<HepMC3::GenEvent> next();
 
+  size_t num_entries();
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i);
+  IEventSourcePtr make_shard(size_t begin, size_t end);
+
   virtual ~HepMC3EventSource();
 };
 
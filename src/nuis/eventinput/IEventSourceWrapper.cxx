@@ -8,7 +8,9 @@ IEventSourceWrapper::IEventSourceWrapper(std::shared_ptr<IEventSource> evs)
     : wrapped_ev_source(evs) {}
 
 std::shared_ptr<IEventSource> IEventSourceWrapper::unwrap() {
-  return wrapped_ev_source;
+  auto wrapper =
+      std::dynamic_pointer_cast<IEventSourceWrapper>(wrapped_ev_source);
+  return wrapper ? wrapper->unwrap() : wrapped_ev_source;
 }
 
 IEventSourceWrapper::~IEventSourceWrapper() {}
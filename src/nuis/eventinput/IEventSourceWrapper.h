@@ -17,10 +17,25 @@ protected:
 public:
   IEventSourceWrapper(std::shared_ptr<IEventSource> evs);
 
+  // Casts the wrapped event source to T, looking through any intermediate
+  // wrappers
   template <typename T> std::shared_ptr<T> as() {
-    return std::dynamic_pointer_cast<T>(wrapped_ev_source);
+    auto evs = std::dynamic_pointer_cast<T>(wrapped_ev_source);
+    return evs ? evs : std::dynamic_pointer_cast<T>(unwrap());
   }
 
+  // Whether any event source in the chain of wrapped sources is a T
+  template <typename T> bool wraps() {
+    if (std::dynamic_pointer_cast<T>(wrapped_ev_source)) {
+      return true;
+    }
+    auto wrapper =
+        std::dynamic_pointer_cast<IEventSourceWrapper>(wrapped_ev_source);
+    return wrapper && wrapper->wraps<T>();
+  }
+
+  // Returns the lowest level event source, looking through any intermediate
+  // wrappers, e.g. PrefetchingEventSource
   std::shared_ptr<IEventSource> unwrap();
 
   virtual ~IEventSourceWrapper();
@@ -8,10 +8,35 @@
 
 #include "HepMC3/GenParticle.h"
 
+#include <cmath>
+
 NEW_NUISANCE_EXCEPT(EventMomentumUnitNotMeV);
 
 namespace nuis {
 
+double NormInfo::sumweights_per_fatx() const {
+  if (!nevents || (fatx == 0) || !std::isfinite(fatx)) {
+    return 0;
+  }
+  return sumweights / fatx;
+}
+
+NormInfo merge(NormInfo const &a, NormInfo const &b) {
+  NormInfo out{0, a.sumweights + b.sumweights, a.nevents + b.nevents};
+
+  double swpf = a.sumweights_per_fatx() + b.sumweights_per_fatx();
+  if (swpf != 0) {
+    out.fatx = out.sumweights / swpf;
+  } else { // at most one has any events, take whichever fatx is set
+    out.fatx = a.nevents ? a.fatx : b.fatx;
+  }
+  return out;
+}
+
+NormInfo operator+(NormInfo const &a, NormInfo const &b) {
+  return merge(a, b);
+}
+
 std::optional<EventCVWeightPair>
 INormalizedEventSource::process(std::shared_ptr<HepMC3::GenEvent> ev) {
   if (!ev) {
@@ -53,13 +78,19 @@ std::optional<EventCVWeightPair> INormalizedEventSource::first() {
     return std::optional<EventCVWeightPair>();
   }
 
+  // only rewind the wrapped source once, some sources, e.g.
+  // PrefetchingEventSource, do significant work on first()
+  auto ev = wrapped_ev_source->first();
+  if (!ev) {
+    return std::optional<EventCVWeightPair>();
+  }
+
   try {
-    xs_acc =
-        NuHepMC::FATX::MakeAccumulator(wrapped_ev_source->first()->run_info());
+    xs_acc = NuHepMC::FATX::MakeAccumulator(ev->run_info());
   } catch (NuHepMC::except const &ex) {
     return std::optional<EventCVWeightPair>();
   }
-  return process(wrapped_ev_source->first());
+  return process(ev);
 }
 
 std::optional<EventCVWeightPair> INormalizedEventSource::next() {
@@ -67,9 +98,33 @@ std::optional<EventCVWeightPair> INormalizedEventSource::next() {
 }
 
 NormInfo INormalizedEventSource::norm_info() {
+  if (!xs_acc) {
+    return {0, 0, 0};
+  }
   return {xs_acc->fatx(), xs_acc->sumweights(), xs_acc->events()};
 }
 
 INormalizedEventSource::~INormalizedEventSource() {}
 
 } // namespace nuis
+
+namespace YAML {
+Node convert<nuis::NormInfo>::encode(nuis::NormInfo const &ni) {
+  Node node;
+  node["fatx"] = ni.fatx;
+  node["sumweights"] = ni.sumweights;
+  node["nevents"] = ni.nevents;
+  return node;
+}
+
+bool convert<nuis::NormInfo>::decode(Node const &node, nuis::NormInfo &ni) {
+  if (!node.IsMap() || !node["fatx"] || !node["sumweights"] ||
+      !node["nevents"]) {
+    return false;
+  }
+  ni.fatx = node["fatx"].as<double>();
+  ni.sumweights = node["sumweights"].as<double>();
+  ni.nevents = node["nevents"].as<size_t>();
+  return true;
+}
+} // namespace YAML
@@ -3,6 +3,8 @@
 #include "nuis/eventinput/IEventSourceIterator.h"
 #include "nuis/eventinput/IEventSourceWrapper.h"
 
+#include "yaml-cpp/yaml.h"
+
 namespace NuHepMC {
 namespace FATX {
 class Accumulator;
@@ -16,9 +18,20 @@ struct NormInfo {
   double sumweights;
   size_t nevents;
 
-  double fatx_per_sumweights() { return fatx / sumweights; }
+  double fatx_per_sumweights() const { return fatx / sumweights; }
+
+  // For both a fixed FATX and one estimated from per-event total cross
+  // sections, sumweights / fatx is additive over independent samples of the
+  // same simulation, which makes it the quantity to merge on.
+  double sumweights_per_fatx() const;
 };
 
+// Combines the normalization of independent samples of the same simulation,
+// e.g. shards of a single input, such that the result is the same as a single
+// pass over all of the events. Associative and commutative.
+NormInfo merge(NormInfo const &a, NormInfo const &b);
+NormInfo operator+(NormInfo const &a, NormInfo const &b);
+
 /// An event source wrapper that keeps track of the FATX, if we cannot determine
 /// how to normalize it, this is considered a resource acquisition failure
 class INormalizedEventSource : public IEventSourceWrapper {
@@ -39,3 +52,10 @@ public:
 };
 
 } // namespace nuis
+
+namespace YAML {
+template <> struct convert<nuis::NormInfo> {
+  static Node encode(nuis::NormInfo const &ni);
+  static bool decode(Node const &node, nuis::NormInfo &ni);
+};
+} // namespace YAML
@@ -0,0 +1,48 @@
+#include "nuis/eventinput/IRangedEventSource.h"
+
+#include "nuis/log.txx"
+
+namespace nuis {
+
+RangedEventSourceShard::RangedEventSourceShard(IRangedEventSourcePtr evs,
+                                               size_t begin, size_t end)
+    : IEventSourceWrapper(evs), source(evs), begin_entry(begin), end_entry(end), ient(begin) {
+  end_entry = std::min(end_entry, source->num_entries());
+  begin_entry = std::min(begin_entry, end_entry);
+  log_debug("RangedEventSourceShard reading entries [{}, {})", begin_entry,
+            end_entry);
+}
+
+std::shared_ptr<HepMC3::GenEvent> RangedEventSourceShard::first() {
+  return seek(0);
+}
+
+std::shared_ptr<HepMC3::GenEvent> RangedEventSourceShard::next() {
+  if (++ient >= end_entry) {
+    ient = end_entry;
+    return nullptr;
+  }
+  return source->next();
+}
+
+size_t RangedEventSourceShard::num_entries() {
+  return end_entry - begin_entry;
+}
+
+std::shared_ptr<HepMC3::GenEvent> RangedEventSourceShard::seek(size_t i) {
+  ient = begin_entry + i;
+  if (ient >= end_entry) {
+    ient = end_entry;
+    return nullptr;
+  }
+  return source->seek(ient);
+}
+
+IEventSourcePtr RangedEventSourceShard::make_shard(size_t begin, size_t end) {
+  return source->make_shard(begin_entry + std::min(begin, num_entries()),
+                            begin_entry + std::min(end, num_entries()));
+}
+
+RangedEventSourceShard::~RangedEventSourceShard() {}
+
+} // namespace nuis
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/IEventSourceWrapper.h"
+
+namespace nuis {
+
+// Optional interface for event sources that can address their events by entry
+// number. This allows a single input to be split into shards that can be
+// processed independently, e.g. on separate threads, processes, or nodes. Use
+// as:
+//
+//   auto ranged = std::dynamic_pointer_cast<IRangedEventSource>(evs);
+//   auto shard = std::make_shared<INormalizedEventSource>(
+//       ranged->make_shard(begin, end));
+//
+// and combine the resulting normalization information afterwards.
+class IRangedEventSource : public IEventSource {
+public:
+  // The total number of events available from this source
+  virtual size_t num_entries() = 0;
+  // Returns the i'th event, subsequent calls to next() continue from i + 1.
+  // Returns nullptr if i is out of range.
+  virtual std::shared_ptr<HepMC3::GenEvent> seek(size_t i) = 0;
+  // Returns a new, independent, event source that reads entries [begin, end)
+  // of this one.
+  virtual IEventSourcePtr make_shard(size_t begin, size_t end) = 0;
+
+  virtual ~IRangedEventSource(){};
+};
+
+using IRangedEventSourcePtr = std::shared_ptr<IRangedEventSource>;
+
+// A view over a contiguous range of entries of an IRangedEventSource. Events
+// keep the entry numbering of the underlying source, which can be reached
+// through the IEventSourceWrapper interface, e.g. by weight calculators that
+// only configure themselves for a specific input type.
+class RangedEventSourceShard : public IRangedEventSource,
+                               public IEventSourceWrapper {
+
+  IRangedEventSourcePtr source;
+  size_t begin_entry;
+  size_t end_entry;
+  size_t ient;
+
+public:
+  RangedEventSourceShard(IRangedEventSourcePtr evs, size_t begin, size_t end);
+
+  std::shared_ptr<HepMC3::GenEvent> first();
+  std::shared_ptr<HepMC3::GenEvent> next();
+
+  size_t num_entries();
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i);
+  IEventSourcePtr make_shard(size_t begin, size_t end);
+
+  virtual ~RangedEventSourceShard();
+};
+
+} // namespace nuis
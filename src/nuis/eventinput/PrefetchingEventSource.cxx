@@ -0,0 +1,99 @@
+#include "nuis/eventinput/PrefetchingEventSource.h"
+
+#include "nuis/log.txx"
+
+#include <algorithm>
+
+namespace nuis {
+
+PrefetchingEventSource::PrefetchingEventSource(
+    std::shared_ptr<IEventSource> evs, size_t prefetch_depth)
+    : IEventSourceWrapper(evs), buffer(std::max(prefetch_depth, size_t(1))),
+      head{0}, count{0}, source_done{true}, stop{false} {}
+
+void PrefetchingEventSource::read_ahead() {
+  while (true) {
+    std::shared_ptr<HepMC3::GenEvent> ev;
+    std::exception_ptr err;
+    try {
+      ev = wrapped_ev_source->next();
+    } catch (...) {
+      err = std::current_exception();
+    }
+
+    std::unique_lock lk(mtx);
+    if (err || !ev) {
+      source_error = err;
+      source_done = true;
+      events_ready.notify_one();
+      return;
+    }
+
+    space_ready.wait(lk, [this] { return stop || (count < buffer.size()); });
+    if (stop) {
+      return;
+    }
+    buffer[(head + count) % buffer.size()] = std::move(ev);
+    count++;
+    events_ready.notify_one();
+  }
+}
+
+void PrefetchingEventSource::stop_reading() {
+  {
+    std::unique_lock lk(mtx);
+    stop = true;
+  }
+  space_ready.notify_one();
+  if (reader.joinable()) {
+    reader.join();
+  }
+
+  std::fill(buffer.begin(), buffer.end(), nullptr);
+  head = 0;
+  count = 0;
+  source_done = true;
+  stop = false;
+  source_error = nullptr;
+}
+
+std::shared_ptr<HepMC3::GenEvent> PrefetchingEventSource::first() {
+  stop_reading();
+
+  if (!wrapped_ev_source) {
+    return nullptr;
+  }
+
+  auto ev = wrapped_ev_source->first();
+  if (!ev) {
+    return nullptr;
+  }
+
+  source_done = false;
+  reader = std::thread(&PrefetchingEventSource::read_ahead, this);
+  return ev;
+}
+
+std::shared_ptr<HepMC3::GenEvent> PrefetchingEventSource::next() {
+  std::unique_lock lk(mtx);
+  events_ready.wait(lk, [this] { return count || source_done; });
+
+  if (!count) {
+    if (source_error) {
+      auto err = source_error;
+      source_error = nullptr;
+      std::rethrow_exception(err);
+    }
+    return nullptr;
+  }
+
+  auto ev = std::move(buffer[head]);
+  head = (head + 1) % buffer.size();
+  count--;
+  space_ready.notify_one();
+  return ev;
+}
+
+PrefetchingEventSource::~PrefetchingEventSource() { stop_reading(); }
+
+} // namespace nuis
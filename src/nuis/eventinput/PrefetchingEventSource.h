@@ -0,0 +1,54 @@
+#pragma once
+
+#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/IEventSourceWrapper.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nuis {
+
+// An event source wrapper that reads up to prefetch_depth events ahead of the
+// consumer on a background thread, so that file I/O and conversion to
+// HepMC3::GenEvent overlaps with event processing. Events are returned in the
+// same order as from the wrapped source.
+//
+// The wrapped source is only ever used from one thread at a time, but it is
+// used from the background thread between calls to first(). Anything that
+// reads from the wrapped source directly while iterating, e.g.
+// GHEP3EventSource::EventRecord as used by the GENIE ReWeight calculator, is
+// not safe to use with prefetching, so WeightCalcFactory::make throws for
+// event sources that wrap a PrefetchingEventSource.
+class PrefetchingEventSource : public IEventSource, public IEventSourceWrapper {
+
+  // fixed-capacity ring buffer of prefetched events
+  std::vector<std::shared_ptr<HepMC3::GenEvent>> buffer;
+  size_t head;
+  size_t count;
+
+  bool source_done;
+  bool stop;
+  std::exception_ptr source_error;
+
+  std::mutex mtx;
+  std::condition_variable events_ready;
+  std::condition_variable space_ready;
+  std::thread reader;
+
+  void read_ahead();
+  void stop_reading();
+
+public:
+  PrefetchingEventSource(std::shared_ptr<IEventSource> evs,
+                         size_t prefetch_depth = 64);
+
+  std::shared_ptr<HepMC3::GenEvent> first();
+  std::shared_ptr<HepMC3::GenEvent> next();
+
+  virtual ~PrefetchingEventSource();
+};
+
+} // namespace nuis
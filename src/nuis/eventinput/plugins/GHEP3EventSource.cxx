@@ -387,8 +387,14 @@ std::string PartToStr(HepMC3::ConstGenParticlePtr pt) {
   return ss.str();
 }
 
-std::shared_ptr<HepMC3::GenEvent> ToGenEvent(genie::GHepRecord const &GHep) {
-  auto evt = std::make_shared<HepMC3::GenEvent>(HepMC3::Units::GEV);
+// evt, if passed, must be an empty event in GeV units, it is filled and
+// returned. Otherwise a new event is allocated.
+std::shared_ptr<HepMC3::GenEvent>
+ToGenEvent(genie::GHepRecord const &GHep,
+           std::shared_ptr<HepMC3::GenEvent> evt = nullptr) {
+  if (!evt) {
+    evt = std::make_shared<HepMC3::GenEvent>(HepMC3::Units::GEV);
+  }
 
   auto proc_id = ConvertGENIEReactionCode(GHep);
   ::NuHepMC::ER3::SetProcessID(*evt, proc_id);
@@ -564,7 +570,9 @@ genie::Spline const *GHEP3EventSource::GetSpline(int tgtpdg, int nupdg) {
   return EvGens[tgtpdg][nupdg]->XSecSumSpline();
 }
 
-GHEP3EventSource::GHEP3EventSource(YAML::Node const &cfg) {
+GHEP3EventSource::GHEP3EventSource(YAML::Node const &cfg)
+    : config(YAML::Clone(cfg)),
+      pool(cfg["event_pool_size"] ? cfg["event_pool_size"].as<size_t>() : 0) {
   log_trace("[GHEP3EventSource] enter");
   if (cfg["filepath"]) {
     log_trace("Checking file {} for tree gtree.",
@@ -668,7 +676,8 @@ std::shared_ptr<HepMC3::GenEvent> GHEP3EventSource::first() {
   ch_fuid = chin->GetFile()->GetUUID();
   ient = 0;
   auto ge = ghepconv::ToGenEvent(
-      static_cast<genie::GHepRecord const &>(*ntpl->event));
+      static_cast<genie::GHepRecord const &>(*ntpl->event),
+      pool.get(HepMC3::Units::GEV));
 
   auto tpart = NuHepMC::Event::GetTargetParticle(*ge);
   auto bpart = NuHepMC::Event::GetBeamParticle(*ge);
@@ -706,7 +715,8 @@ std::shared_ptr<HepMC3::GenEvent> GHEP3EventSource::next() {
   }
 
   auto ge = ghepconv::ToGenEvent(
-      static_cast<genie::GHepRecord const &>(*ntpl->event));
+      static_cast<genie::GHepRecord const &>(*ntpl->event),
+      pool.get(HepMC3::Units::GEV));
   ge->set_event_number(ient);
   ge->set_run_info(gri);
   ge->set_units(HepMC3::Units::MEV, HepMC3::Units::CM);
@@ -723,6 +733,29 @@ std::shared_ptr<HepMC3::GenEvent> GHEP3EventSource::next() {
   return ge;
 }
 
+size_t GHEP3EventSource::num_entries() {
+  if (!chin && !first()) {
+    return 0;
+  }
+  return ch_ents;
+}
+
+std::shared_ptr<HepMC3::GenEvent> GHEP3EventSource::seek(size_t i) {
+  if (!chin && !first()) {
+    return nullptr;
+  }
+  if (Long64_t(i) >= ch_ents) {
+    return nullptr;
+  }
+  ient = Long64_t(i) - 1;
+  return next();
+}
+
+IEventSourcePtr GHEP3EventSource::make_shard(size_t begin, size_t end) {
+  return std::make_shared<RangedEventSourceShard>(
+      std::make_shared<GHEP3EventSource>(config), begin, end);
+}
+
 genie::EventRecord const *
 GHEP3EventSource::EventRecord(HepMC3::GenEvent const &ev) {
   chin->GetEntry(ev.event_number());
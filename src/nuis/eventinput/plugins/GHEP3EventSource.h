@@ -1,6 +1,7 @@
 #pragma once
 
-#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/GenEventPool.h"
+#include "nuis/eventinput/IRangedEventSource.h"
 
 #include "TChain.h"
 
@@ -23,13 +24,17 @@ class Spline;
 
 namespace nuis {
 
-class GHEP3EventSource : public IEventSource {
+class GHEP3EventSource : public IRangedEventSource {
+
+  YAML::Node config;
 
   std::vector<std::filesystem::path> filepaths;
   std::unique_ptr<TChain> chin;
 
   std::shared_ptr<HepMC3::GenRunInfo> gri;
 
+  GenEventPool pool;
+
   Long64_t ch_ents;
   Long64_t ient;
   TUUID ch_fuid;
@@ -50,6 +55,10 @@ public:
 
   std::shared_ptr<HepMC3::GenEvent> next();
 
+  size_t num_entries();
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i);
+  IEventSourcePtr make_shard(size_t begin, size_t end);
+
   static IEventSourcePtr MakeEventSource(YAML::Node const &cfg);
 
   genie::EventRecord const *EventRecord(HepMC3::GenEvent const &ev);
@@ -1,6 +1,7 @@
 #include "nuis/except.h"
 #include "nuis/log.txx"
 
+#include "nuis/eventinput/GenEventPool.h"
 #include "nuis/eventinput/IEventSource.h"
 
 #include "nuis/eventinput/plugins/ROOTUtils.h"
@@ -255,6 +256,8 @@ class NUISANCE2FlattTreeEventSource : public IEventSource {
 
   std::shared_ptr<HepMC3::GenRunInfo> gri;
 
+  GenEventPool pool;
+
   Long64_t ient;
   double fatx;
 
@@ -289,7 +292,7 @@ class NUISANCE2FlattTreeEventSource : public IEventSource {
   std::unique_ptr<TTreeReaderValue<int>> tgt;
 
   std::shared_ptr<HepMC3::GenEvent> ToGenEvent() {
-    auto evt = std::make_shared<HepMC3::GenEvent>(HepMC3::Units::GEV);
+    auto evt = pool.get(HepMC3::Units::GEV);
 
     NuHepMC::ER3::SetProcessID(*evt, GetEC1Channel(**Mode));
 
@@ -397,7 +400,9 @@ class NUISANCE2FlattTreeEventSource : public IEventSource {
   }
 
 public:
-  NUISANCE2FlattTreeEventSource(YAML::Node const &cfg) {
+  NUISANCE2FlattTreeEventSource(YAML::Node const &cfg)
+      : pool(cfg["event_pool_size"] ? cfg["event_pool_size"].as<size_t>()
+                                    : 0) {
     log_trace("[NUISANCE2FlattTreeEventSource] enter");
     if (cfg["filepath"]) {
       log_trace("Checking file {} for tree FlatTree_VARS.",
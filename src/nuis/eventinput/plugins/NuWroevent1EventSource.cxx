@@ -1,4 +1,4 @@
-#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/IRangedEventSource.h"
 
 #include "nuis/eventinput/plugins/ROOTUtils.h"
 
@@ -20,7 +20,9 @@
 
 namespace nuis {
 
-class NuWroevent1EventSource : public IEventSource {
+class NuWroevent1EventSource : public IRangedEventSource {
+
+  YAML::Node config;
 
   std::vector<std::filesystem::path> filepaths;
   std::unique_ptr<TChain> chin;
@@ -36,7 +38,7 @@ class NuWroevent1EventSource : public IEventSource {
   event *ev;
 
 public:
-  NuWroevent1EventSource(YAML::Node const &cfg) {
+  NuWroevent1EventSource(YAML::Node const &cfg) : config(YAML::Clone(cfg)) {
     if (cfg["filepath"] &&
         HasTTree(cfg["filepath"].as<std::string>(), "treeout")) {
       filepaths.push_back(cfg["filepath"].as<std::string>());
@@ -111,6 +113,29 @@ public:
     return ge;
   }
 
+  size_t num_entries() {
+    if (!chin && !first()) {
+      return 0;
+    }
+    return ch_ents;
+  }
+
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i) {
+    if (!chin && !first()) {
+      return nullptr;
+    }
+    if (Long64_t(i) >= ch_ents) {
+      return nullptr;
+    }
+    ient = Long64_t(i) - 1;
+    return next();
+  }
+
+  IEventSourcePtr make_shard(size_t begin, size_t end) {
+    return std::make_shared<RangedEventSourceShard>(
+        std::make_shared<NuWroevent1EventSource>(config), begin, end);
+  }
+
   static IEventSourcePtr MakeEventSource(YAML::Node const &cfg) {
     return std::make_shared<NuWroevent1EventSource>(cfg);
   }
@@ -21,7 +21,8 @@ namespace nuis {
 
 NEW_NUISANCE_EXCEPT(NeutVectNoFluxRateHistos);
 
-neutvectEventSource::neutvectEventSource(YAML::Node const &cfg) {
+neutvectEventSource::neutvectEventSource(YAML::Node const &cfg)
+    : config(YAML::Clone(cfg)) {
   if (cfg["filepath"] &&
       HasTTree(cfg["filepath"].as<std::string>(), "neuttree")) {
     filepaths.push_back(cfg["filepath"].as<std::string>());
@@ -121,6 +122,29 @@ std::shared_ptr<HepMC3::GenEvent> neutvectEventSource::next() {
   return ge;
 }
 
+size_t neutvectEventSource::num_entries() {
+  if (!chin && !first()) {
+    return 0;
+  }
+  return ch_ents;
+}
+
+std::shared_ptr<HepMC3::GenEvent> neutvectEventSource::seek(size_t i) {
+  if (!chin && !first()) {
+    return nullptr;
+  }
+  if (Long64_t(i) >= ch_ents) {
+    return nullptr;
+  }
+  ient = Long64_t(i) - 1;
+  return next();
+}
+
+IEventSourcePtr neutvectEventSource::make_shard(size_t begin, size_t end) {
+  return std::make_shared<RangedEventSourceShard>(
+      std::make_shared<neutvectEventSource>(config), begin, end);
+}
+
 NeutVect *neutvectEventSource::neutvect(HepMC3::GenEvent const &ev) {
   chin->GetEntry(ev.event_number());
   return nv;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "nuis/eventinput/IEventSource.h"
+#include "nuis/eventinput/IRangedEventSource.h"
 
 #include "TChain.h"
 
@@ -18,7 +18,9 @@ class NeutVect;
 
 namespace nuis {
 
-class neutvectEventSource : public IEventSource {
+class neutvectEventSource : public IRangedEventSource {
+
+  YAML::Node config;
 
   std::vector<std::filesystem::path> filepaths;
   std::unique_ptr<TChain> chin;
@@ -37,6 +39,10 @@ public:
   std::shared_ptr<HepMC3::GenEvent> first();
   std::shared_ptr<HepMC3::GenEvent> next();
 
+  size_t num_entries();
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i);
+  IEventSourcePtr make_shard(size_t begin, size_t end);
+
   static IEventSourcePtr MakeEventSource(YAML::Node const &cfg);
 
   NeutVect *neutvect(HepMC3::GenEvent const &);
@@ -46,7 +46,7 @@ BinnedValuesBase::find_bin(std::vector<double> const &projections) const {
     return npos;
   }
 
-  // can't search too far as we use a possibly oversized static local vector
+  // projections beyond the number of axes are not used by the binning
   auto end = projections.begin() + binning->number_of_axes();
   if (std::find(projections.begin(), end, kMissingDatum<double>) != end) {
     NUIS_LOG_DEBUG("Found kMissingDatum flag in projection vector passed to "
@@ -61,10 +61,57 @@ BinnedValuesBase::find_bin(std::vector<double> const &projections) const {
   return binning->find_bin(projections);
 }
 
+Binning::BinIndices
+BinnedValuesBase::find_bins(Binning::ProjectionsRef const &projections) const {
+  auto nax = Eigen::Index(binning->number_of_axes());
+  if (projections.cols() < nax) {
+    NUIS_LOG_DEBUG("Too few projection columns passed to "
+                   "BinnedValuesBase::find_bins: {}. Compile with "
+                   "CMAKE_BUILD_TYPE=Debug to make this an exception.",
+                   projections.cols());
+#ifndef NUIS_NDEBUG
+    throw MismatchedAxisCount();
+#endif
+    return Binning::BinIndices::Constant(projections.rows(), npos);
+  }
+
+  auto missing =
+      (projections.leftCols(nax) == kMissingDatum<double>).rowwise().any();
+  if (missing.any()) {
+    NUIS_LOG_DEBUG("Found kMissingDatum flag in {} rows of projections "
+                   "passed to BinnedValuesBase::find_bins",
+                   missing.count());
+#ifndef NUIS_NDEBUG
+    throw MissingProjectionEncountered();
+#endif
+    return missing.select(Binning::npos, binning->find_bins(projections));
+  }
+
+  return binning->find_bins(projections);
+}
+
 Binning::index_t BinnedValuesBase::find_bin(double proj) const {
-  static std::vector<double> dummy = {0};
-  dummy[0] = proj;
-  return find_bin(dummy);
+  if (binning->number_of_axes() > 1) {
+    NUIS_LOG_DEBUG("Single projection passed to BinnedValuesBase::find_bin for "
+                   "a binning with {} axes. Compile with "
+                   "CMAKE_BUILD_TYPE=Debug to make this an exception.",
+                   binning->number_of_axes());
+#ifndef NUIS_NDEBUG
+    throw MismatchedAxisCount();
+#endif
+    return npos;
+  }
+
+  if (proj == kMissingDatum<double>) {
+    NUIS_LOG_DEBUG("Found kMissingDatum flag in projection passed to "
+                   "BinnedValuesBase::find_bin");
+#ifndef NUIS_NDEBUG
+    throw MissingProjectionEncountered();
+#endif
+    return npos;
+  }
+
+  return binning->find_bin(proj);
 }
 
 BinnedValuesBase::BinnedValuesBase(BinningPtr binop,
@@ -48,6 +48,10 @@ struct BinnedValuesBase : public nuis_named_log("HistFrame") {
   Binning::index_t find_bin(std::vector<double> const &projections) const;
   // convenience for 1D histograms
   Binning::index_t find_bin(double projection) const;
+  // bins every row of projections, which must have a column for each axis,
+  // with a single call to Binning::find_bins
+  Binning::BinIndices
+  find_bins(Binning::ProjectionsRef const &projections) const;
 
   // adjusts the shape of the data and uncertainty matrices so that
   // they are at least big enough to hold the binned values for
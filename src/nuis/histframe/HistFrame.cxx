@@ -1,4 +1,5 @@
 #include "nuis/histframe/HistFrame.h"
+#include "nuis/histframe/exceptions.h"
 
 #include "nuis/eventframe/missing_datum.h"
 
@@ -8,8 +9,6 @@
 
 #include "fmt/ranges.h"
 
-NEW_NUISANCE_EXCEPT(InvalidColumnAccess);
-
 namespace nuis {
 
 HistFrame::column_view HistFrame::operator[](HistFrame::column_t colid) {
@@ -79,6 +78,78 @@ void HistFrame::fill_bin(Binning::index_t i, double weight,
   num_fills++;
 }
 
+namespace {
+template <typename ColumnFor>
+void fill_bins_impl(HistFrame &hf, Binning::BinIndices const &bins,
+                    Eigen::Ref<Eigen::ArrayXd const> const &weights,
+                    ColumnFor const &column_for) {
+
+  if (bins.size() != weights.size()) {
+    hf.log_critical("Tried to fill {} bins with {} weights.", bins.size(),
+                    weights.size());
+    throw MismatchedAxisCount();
+  }
+
+  Eigen::Index nbins = hf.sumweights.rows();
+  Eigen::Index ncols = hf.sumweights.cols();
+  double *sumweights = hf.sumweights.data();
+  double *variances = hf.variances.data();
+
+  size_t nfilled = 0;
+#ifndef NDEBUG
+  size_t nout_of_range = 0, nnon_normal = 0;
+#endif
+  for (Eigen::Index i = 0; i < bins.size(); ++i) {
+    Eigen::Index bin = bins[i], col = column_for(i);
+    double weight = weights[i];
+
+    if ((bin >= nbins) || (col >= ncols) || !std::isnormal(weight)) {
+#ifndef NDEBUG
+      nout_of_range += (bin >= nbins);
+      nnon_normal += (bin < nbins) && (weight != 0) && !std::isnormal(weight);
+#endif
+      continue;
+    }
+
+    // column-major storage
+    sumweights[bin + col * nbins] += weight;
+    variances[bin + col * nbins] += weight * weight;
+    nfilled++;
+  }
+
+#ifndef NDEBUG
+  if (nout_of_range) {
+    hf.log_info("Tried to Fill histogram with {} out of range bins.",
+                nout_of_range);
+  }
+  if (nnon_normal) {
+    hf.log_warn("Tried to Fill histogram with {} non-normal weights.",
+                nnon_normal);
+  }
+#endif
+
+  hf.num_fills += nfilled;
+}
+} // namespace
+
+void HistFrame::fill_bins(Binning::BinIndices const &bins,
+                          Eigen::Ref<Eigen::ArrayXd const> const &weights,
+                          column_t col) {
+  fill_bins_impl(*this, bins, weights, [=](Eigen::Index) { return col; });
+}
+
+void HistFrame::fill_bins(Binning::BinIndices const &bins,
+                          Eigen::Ref<Eigen::ArrayXd const> const &weights,
+                          ColumnIndices const &cols) {
+  if (bins.size() != cols.size()) {
+    log_critical("Tried to fill {} bins with {} columns.", bins.size(),
+                 cols.size());
+    throw MismatchedAxisCount();
+  }
+  fill_bins_impl(*this, bins, weights,
+                 [&](Eigen::Index i) { return cols[i]; });
+}
+
 void HistFrame::fill(std::vector<double> const &projections, double weight) {
   fill_bin(find_bin(projections), weight, 0);
 }
@@ -102,25 +173,21 @@ void HistFrame::fill_column_if(bool selected,
 
 // convenience for 1D histograms
 void HistFrame::fill(double projection, double weight) {
-  static std::vector<double> projv = {0};
-  projv[0] = projection;
-  fill(projv, weight);
+  fill_bin(find_bin(projection), weight, 0);
 }
 void HistFrame::fill_column(double projection, double weight, column_t col) {
-  static std::vector<double> projv = {0};
-  projv[0] = projection;
-  fill_column(projv, weight, col);
+  fill_bin(find_bin(projection), weight, col);
 }
 void HistFrame::fill_if(bool selected, double projection, double weight) {
-  static std::vector<double> projv = {0};
-  projv[0] = projection;
-  fill_if(selected, projv, weight);
+  if (selected) {
+    fill_bin(find_bin(projection), weight, 0);
+  }
 }
 void HistFrame::fill_column_if(bool selected, double projection, double weight,
                                column_t col) {
-  static std::vector<double> projv = {0};
-  projv[0] = projection;
-  fill_column_if(selected, projv, weight, col);
+  if (selected) {
+    fill_bin(find_bin(projection), weight, col);
+  }
 }
 
 BinnedValues HistFrame::finalise(bool divide_by_bin_sizes) const {
@@ -136,8 +203,8 @@ BinnedValues HistFrame::finalise(bool divide_by_bin_sizes) const {
 
   if (divide_by_bin_sizes) {
     auto bin_sizes = binning->bin_sizes();
-    bv.values /= bin_sizes;
-    bv.errors /= bin_sizes;
+    bv.values.colwise() /= bin_sizes;
+    bv.errors.colwise() /= bin_sizes;
   }
 
   return bv;
@@ -149,6 +216,46 @@ void HistFrame::reset() {
   num_fills = 0;
 }
 
+HistFrame &HistFrame::merge(HistFrame const &other) {
+  if ((sumweights.rows() != other.sumweights.rows()) ||
+      (sumweights.cols() != other.sumweights.cols())) {
+    log_critical("Tried to merge HistFrame with {} bins and {} columns into "
+                 "one with {} bins and {} columns.",
+                 other.sumweights.rows(), other.sumweights.cols(),
+                 sumweights.rows(), sumweights.cols());
+    throw IncompatibleHistFrames();
+  }
+
+  sumweights += other.sumweights;
+  variances += other.variances;
+  num_fills += other.num_fills;
+
+  return *this;
+}
+
+HistFrame::ConcurrentFiller HistFrame::concurrent_filler(size_t nthreads) {
+  return ConcurrentFiller(*this, nthreads);
+}
+
+HistFrame::ConcurrentFiller::ConcurrentFiller(HistFrame &p, size_t nthreads)
+    : parent(&p), accumulators(nthreads, padded_accumulator{p}) {
+  for (auto &acc : accumulators) {
+    acc.hf.reset();
+  }
+}
+
+HistFrame &HistFrame::ConcurrentFiller::merge() {
+  for (auto &acc : accumulators) {
+    parent->merge(acc.hf);
+    acc.hf.reset();
+  }
+  return *parent;
+}
+
+BinnedValues HistFrame::ConcurrentFiller::finalise(bool divide_by_bin_sizes) {
+  return merge().finalise(divide_by_bin_sizes);
+}
+
 void HistFrame::resize() {
   if (sumweights.rows() < int(binning->bins.size())) {
     sumweights =
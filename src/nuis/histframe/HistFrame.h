@@ -65,10 +65,33 @@ struct HistFrame : public BinnedValuesBase {
 
   void fill_bin(Binning::index_t bini, double weight, column_t col);
 
+  using ColumnIndices = Eigen::Array<column_t, Eigen::Dynamic, 1>;
+
+  // Equivalent to calling fill_bin(bins[i], weights[i], col) for every entry,
+  // but without the per-call overhead. The second overload fills each entry
+  // into its own column, entries with a column of npos are skipped.
+  void fill_bins(Binning::BinIndices const &bins,
+                 Eigen::Ref<Eigen::ArrayXd const> const &weights, column_t col);
+  void fill_bins(Binning::BinIndices const &bins,
+                 Eigen::Ref<Eigen::ArrayXd const> const &weights,
+                 ColumnIndices const &cols);
+
   BinnedValues finalise(bool divide_by_bin_sizes = true) const;
 
   void reset();
 
+  // Adds the accumulated fills from other, which must have the same binning
+  // shape and columns, as if they had been filled into this HistFrame. Used to
+  // combine results from independently processed samples.
+  HistFrame &merge(HistFrame const &other);
+
+  class ConcurrentFiller;
+
+  // Creates nthreads private accumulators with the same binning and columns as
+  // this HistFrame, see HistFrame::ConcurrentFiller. This HistFrame must
+  // outlive the returned filler.
+  ConcurrentFiller concurrent_filler(size_t nthreads);
+
   // adjusts the shape of BinnedValues::values and BinnedValues::errors so that
   // they are at least big enough to hold the binned values for
   // column_info.size(). Will not remove or overwrite data.
@@ -79,4 +102,35 @@ struct HistFrame : public BinnedValuesBase {
   Eigen::ArrayXXd get_bin_uncertainty_squared() const { return variances; }
 };
 
+// Gives each filling thread its own HistFrame to fill, so that threads never
+// write to shared bins and no locking is needed. Thread i should only fill
+// filler[i]. Once every thread has finished, merge() adds the accumulators
+// into the parent HistFrame in index order, so results do not depend on how
+// the threads were scheduled.
+class HistFrame::ConcurrentFiller {
+  // keep accumulators that are filled by different threads on separate cache
+  // lines
+  struct alignas(64) padded_accumulator {
+    HistFrame hf;
+  };
+
+  HistFrame *parent;
+  std::vector<padded_accumulator> accumulators;
+
+public:
+  ConcurrentFiller(HistFrame &parent, size_t nthreads);
+
+  HistFrame &operator[](size_t thread_index) {
+    return accumulators[thread_index].hf;
+  }
+  size_t size() const { return accumulators.size(); }
+
+  // Adds every accumulator to the parent HistFrame and resets them, so the
+  // filler can be reused. Must not be called while any thread is filling.
+  HistFrame &merge();
+
+  // merge() followed by HistFrame::finalise on the parent
+  BinnedValues finalise(bool divide_by_bin_sizes = true);
+};
+
 } // namespace nuis
\ No newline at end of file
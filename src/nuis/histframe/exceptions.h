@@ -6,4 +6,5 @@ namespace nuis {
 NEW_NUISANCE_EXCEPT(MissingProjectionEncountered);
 NEW_NUISANCE_EXCEPT(InvalidColumnAccess);
 NEW_NUISANCE_EXCEPT(InvalidColumnName);
+NEW_NUISANCE_EXCEPT(IncompatibleHistFrames);
 } // namespace nuis
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "fmt/core.h"
 
+#include <unordered_map>
+
 namespace nuis {
 
 template <bool fill_columns, bool fill_if, bool autoprocidcolumns,
@@ -59,9 +61,6 @@ void fill_procid_columns_from_EventFrame_if_impl(
     }
   }
 
-  std::vector<double> projs(projection_column_names.size(), 0);
-  double weight = 1;
-
   std::vector<EventFrame::column_t> proj_colids;
   for (auto const &proj_col_name : projection_column_names) {
     proj_colids.push_back(ef.find_column_index(proj_col_name));
@@ -130,55 +129,163 @@ void fill_procid_columns_from_EventFrame_if_impl(
     }
   }
 
-  for (auto row : ef.table.rowwise()) {
-
-    if constexpr (fill_if) {
-      if (row(cond_col) == 0) {
-        continue;
-      }
+  // Each column is read through a contiguous span, widening natively typed
+  // columns once up front, so that the loop below streams through memory
+  // rather than striding across the column-major table for every row.
+  std::vector<Eigen::ArrayXd> scratch(
+      4 + proj_colids.size() + weight_colids.size() +
+      auto_weight_ecolids.size());
+  size_t nscratch = 0;
+  auto column_data = [&](EventFrame::column_t cid,
+                         std::string const &name) -> double const * {
+    if (cid == EventFrame::npos) {
+      throw InvalidColumnAccess()
+          << name << " column does not exist in EventFrame.\n"
+          << ef;
     }
+    return ef.span_as_double(ef.column_location(cid), scratch[nscratch++])
+        .data();
+  };
 
-    weight = 1;
-    for (auto wid : weight_colids) {
-      weight *= row(wid);
-    }
+  double const *cond_data = nullptr;
+  if constexpr (fill_if) {
+    cond_data = column_data(cond_col, conditional_column_name);
+  }
+  double const *colsel_data = nullptr;
+  if constexpr (fill_columns) {
+    colsel_data = column_data(colsel_col, column_selector_column_name);
+  }
+  double const *procid_data = nullptr;
+  if constexpr (autoprocidcolumns) {
+    procid_data = column_data(procid_col, "process.id");
+  }
+  std::vector<double const *> proj_data;
+  for (size_t pi = 0; pi < proj_colids.size(); ++pi) {
+    proj_data.push_back(
+        column_data(proj_colids[pi], projection_column_names[pi]));
+  }
+  std::vector<double const *> weight_data;
+  for (size_t wi = 0; wi < weight_colids.size(); ++wi) {
+    weight_data.push_back(
+        column_data(weight_colids[wi], weight_column_names[wi]));
+  }
+  std::vector<double const *> auto_weight_data;
+  for (size_t wi = 0; wi < auto_weight_ecolids.size(); ++wi) {
+    auto_weight_data.push_back(
+        column_data(auto_weight_ecolids[wi], column_weighter_names[wi]));
+  }
 
-    for (size_t pi = 0; pi < proj_colids.size(); ++pi) {
-      projs[pi] = row(proj_colids[pi]);
+  // only the selected rows are binned
+  std::vector<Eigen::Index> selected_rows;
+  Eigen::Index nrows = ef.table.rows();
+  if constexpr (fill_if) {
+    for (Eigen::Index row = 0; row < ef.table.rows(); ++row) {
+      if (cond_data[row] != 0) {
+        selected_rows.push_back(row);
+      }
     }
+    nrows = selected_rows.size();
+  }
 
-    auto bin = hf.find_bin(projs);
-    hf.fill_bin(bin, weight, 0);
-
-    if constexpr (fill_columns) {
-      HistFrame::column_t col = row(colsel_col);
-      if (col > 0) {
-        hf.fill_bin(bin, weight, col);
+  // the selected rows of a column, which only need to be copied for fill_if
+  auto selected = [&](double const *data) {
+    if constexpr (fill_if) {
+      Eigen::ArrayXd rtn(nrows);
+      for (Eigen::Index i = 0; i < nrows; ++i) {
+        rtn[i] = data[selected_rows[i]];
       }
+      return rtn;
+    } else {
+      return Eigen::Map<Eigen::ArrayXd const>(data, nrows);
     }
+  };
+
+  // The first pass bins all rows with one call so that the binning can use a
+  // vectorized kernel, rather than one type-erased call per row, and resolves
+  // the weight and target columns for every row. The second pass scatters the
+  // weights into the HistFrame with HistFrame::fill_bins. Every HistFrame
+  // column is still filled in row order, so the sums are identical to filling
+  // row by row.
+  using ProjectionsMap =
+      Eigen::Map<Eigen::ArrayXXd const, 0, Eigen::OuterStride<>>;
+  Eigen::ArrayXXd projections_copy;
+  auto projections = [&]() {
+    // projection columns that sit next to each other in the table can be
+    // binned in place
+    bool in_place = !fill_if && proj_data.size();
+    for (size_t pi = 1; pi < proj_data.size(); ++pi) {
+      in_place = in_place &&
+                 (proj_data[pi] == (proj_data[0] + pi * ef.table.rows()));
+    }
+    if (in_place) {
+      return ProjectionsMap(proj_data[0], nrows, proj_data.size(),
+                            Eigen::OuterStride<>(ef.table.rows()));
+    }
+    projections_copy.resize(nrows, proj_data.size());
+    for (size_t pi = 0; pi < proj_data.size(); ++pi) {
+      projections_copy.col(pi) = selected(proj_data[pi]);
+    }
+    return ProjectionsMap(projections_copy.data(), nrows, proj_data.size(),
+                          Eigen::OuterStride<>(nrows));
+  }();
+  Binning::BinIndices bins = hf.find_bins(projections);
+
+  Eigen::ArrayXd weights_product;
+  auto weights = [&]() {
+    if (!fill_if && (weight_data.size() == 1)) {
+      return Eigen::Map<Eigen::ArrayXd const>(weight_data.front(), nrows);
+    }
+    weights_product = Eigen::ArrayXd::Ones(nrows);
+    for (auto wd : weight_data) {
+      weights_product *= selected(wd);
+    }
+    return Eigen::Map<Eigen::ArrayXd const>(weights_product.data(), nrows);
+  }();
 
-    if constexpr (autoprocidcolumns) {
-      int colv = row(procid_col);
-      auto it =
-          std::find(proc_id_dictionary.begin(), proc_id_dictionary.end(), colv);
-
-      if (it == proc_id_dictionary.end()) {
-        proc_id_dictionary.push_back(colv);
-        hf.add_column(fmt::format("{}", colv));
-        it = std::find(proc_id_dictionary.begin(), proc_id_dictionary.end(),
-                       colv);
-      }
+  hf.fill_bins(bins, weights, 0);
 
-      HistFrame::column_t col = 1 + (it - proc_id_dictionary.begin());
+  if constexpr (fill_columns) {
+    auto colsel = selected(colsel_data);
+    HistFrame::ColumnIndices cols =
+        (colsel >= 1)
+            .select(colsel, double(HistFrame::npos))
+            .template cast<HistFrame::column_t>();
+    hf.fill_bins(bins, weights, cols);
+  }
 
-      hf.fill_bin(bin, weight, col);
+  if constexpr (autoprocidcolumns) {
+    std::unordered_map<int, HistFrame::column_t> procid_columns;
+    for (size_t pid_it = 0; pid_it < proc_id_dictionary.size(); ++pid_it) {
+      procid_columns[proc_id_dictionary[pid_it]] = 1 + pid_it;
     }
 
-    if constexpr (autoweightcolumns) {
-      for (size_t col_it = 0; col_it < auto_weight_ecolids.size(); ++col_it) {
-        hf.fill_bin(bin, weight * row(auto_weight_ecolids[col_it]),
-                    auto_weight_hcolids[col_it]);
+    // events are usually grouped by process, so remember the last lookup
+    int last_procid = 0;
+    HistFrame::column_t last_col = HistFrame::npos;
+
+    HistFrame::ColumnIndices cols(nrows);
+    auto procids = selected(procid_data);
+    for (Eigen::Index i = 0; i < nrows; ++i) {
+      int colv = procids[i];
+      if ((last_col == HistFrame::npos) || (colv != last_procid)) {
+        auto it = procid_columns.find(colv);
+        if (it == procid_columns.end()) {
+          it = procid_columns
+                   .emplace(colv, hf.add_column(fmt::format("{}", colv)))
+                   .first;
+        }
+        last_procid = colv;
+        last_col = it->second;
       }
+      cols[i] = last_col;
+    }
+    hf.fill_bins(bins, weights, cols);
+  }
+
+  if constexpr (autoweightcolumns) {
+    for (size_t col_it = 0; col_it < auto_weight_ecolids.size(); ++col_it) {
+      hf.fill_bins(bins, weights * selected(auto_weight_data[col_it]),
+                   auto_weight_hcolids[col_it]);
     }
   }
 }
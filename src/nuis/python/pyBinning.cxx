@@ -32,6 +32,10 @@ void pyBinningInit(py::module &m) {
            [](BinningPtr binning, std::vector<double> const &x) {
              return binning->find_bin(x);
            })
+      .def("find_bins",
+           [](BinningPtr binning, Eigen::ArrayXXd const &x) {
+             return binning->find_bins(x);
+           })
       .def_static("lin_space", &Binning::lin_space, py::arg("nbins"),
                   py::arg("start"), py::arg("stop"), py::arg("label") = "")
       .def_static("ln_space", &Binning::ln_space, py::arg("nbins"),
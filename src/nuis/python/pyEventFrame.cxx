@@ -3,6 +3,9 @@
 #ifdef NUIS_ARROW_ENABLED
 // header that
 #include "arrow/python/pyarrow.h"
+
+#include "arrow/c/abi.h"
+#include "arrow/c/bridge.h"
 #endif
 
 namespace py = pybind11;
@@ -126,6 +129,27 @@ pyEventFrameGen pyEventFrameGen::progress(size_t nmax) {
   return *this;
 }
 
+pyEventFrameGen pyEventFrameGen::threads(size_t nthreads, size_t batch_size) {
+  *gen = gen->threads(nthreads, batch_size);
+  return *this;
+}
+
+pyEventFrameGen
+pyEventFrameGen::cache(std::string const &cache_dir,
+                       std::vector<std::string> const &input_files,
+                       std::string const &projection_id) {
+  *gen = gen->cache(cache_dir,
+                    std::vector<std::filesystem::path>(input_files.begin(),
+                                                       input_files.end()),
+                    projection_id);
+  return *this;
+}
+
+pyEventFrameGen pyEventFrameGen::typed_storage(bool enable) {
+  *gen = gen->typed_storage(enable);
+  return *this;
+}
+
 nuis::EventFrame pyEventFrameGen::first(size_t nchunk) {
   return gen->first(nchunk);
 }
@@ -149,19 +173,85 @@ pybind11::object pyEventFrameGen::nextArrow(size_t nchunk) {
   }
   return py::none();
 }
+pybind11::object pyEventFrameGen::arrowReader(size_t nchunk) {
+  auto reader = std::make_shared<EventFrameGenRecordBatchReader>(gen, nchunk);
+
+  // pyarrow takes ownership of the stream, and so of the reader, by moving it
+  // out of this struct
+  ArrowArrayStream stream;
+  auto status = arrow::ExportRecordBatchReader(reader, &stream);
+  if (!status.ok()) {
+    throw std::runtime_error(status.ToString());
+  }
+
+  try {
+    return py::module::import("pyarrow")
+        .attr("RecordBatchReader")
+        .attr("_import_from_c")(reinterpret_cast<uintptr_t>(&stream));
+  } catch (...) {
+    if (stream.release) {
+      stream.release(&stream);
+    }
+    throw;
+  }
+}
+void pyEventFrameGen::write_arrow_ipc(std::string const &path, size_t nchunk) {
+  gen->write_arrow_ipc(path, nchunk);
+}
+#ifdef NUIS_PARQUET_ENABLED
+void pyEventFrameGen::write_parquet(std::string const &path,
+                                    size_t row_group_size) {
+  gen->write_parquet(path, row_group_size);
+}
+#endif
 #endif
 
 NormInfo pyEventFrameGen::norm_info() const { return gen->norm_info(); }
 
-Eigen::ArrayXdRef frame_gettattr(EventFrame &s, std::string const &column) {
-  return s.col(column);
+#define COLUMN_TYPE_ITER                                                       \
+  X(bool)                                                                      \
+  X(int)                                                                       \
+  X(uint)                                                                      \
+  X(int16_t)                                                                   \
+  X(uint16_t)                                                                  \
+  X(float)                                                                     \
+  X(double)
+
+// natively typed columns are returned as numpy arrays of the native type that
+// reference the frame's storage, and keep the frame alive, as the column
+// references are temporaries they must be cast with an explicit policy
+py::object frame_gettattr(EventFrame &s, std::string const &column) {
+  auto cid = s.find_column_index(column);
+  if (cid == EventFrame::npos) {
+    throw InvalidFrameColumnName() << column;
+  }
+
+  auto parent = py::cast(&s);
+  switch (s.column_location(cid).typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id:                                                     \
+    return py::cast(s.col<t>(column),                                          \
+                    py::return_value_policy::reference_internal, parent);
+    COLUMN_TYPE_ITER
+#undef X
+  }
+  return py::none();
 }
 
 void frame_settattr(EventFrame &s, std::string const &column,
-                    Eigen::ArrayXdRef const data) {
+                    py::object const &data) {
   auto cid = s.find_column_index(column);
-  if (cid != EventFrame::npos) {
-    s.table.col(cid) = data;
+  if (cid == EventFrame::npos) {
+    return;
+  }
+
+  switch (s.column_location(cid).typenum) {
+#define X(t)                                                                   \
+  case column_type<t>::id:                                                     \
+    s.col<t>(column) = data.cast<Eigen::Array<t, Eigen::Dynamic, 1>>();        \
+    break;
+    COLUMN_TYPE_ITER
+#undef X
   }
 }
 
@@ -182,6 +272,7 @@ void pyEventFrameInit(py::module &m) {
       .def_readonly("num_rows", &EventFrame::num_rows)
       .def("__bool__", [](EventFrame const &s) { return bool(s.table.rows()); })
       .def("find_column_index", &EventFrame::find_column_index)
+      .def("widened", &EventFrame::widened)
       .def_readonly_static("npos", &EventFrame::npos)
       .def_readonly_static("missing_datum", &kMissingDatum<double>)
       .def("__getattr__", &frame_gettattr)
@@ -198,6 +289,11 @@ void pyEventFrameInit(py::module &m) {
       .def_static("has_arrow_support", []() { return true; })
 #else
       .def_static("has_arrow_support", []() { return false; })
+#endif
+#ifdef NUIS_PARQUET_ENABLED
+      .def_static("has_parquet_support", []() { return true; })
+#else
+      .def_static("has_parquet_support", []() { return false; })
 #endif
       .def("add_column", &pyEventFrameGen::add_double_column)
       .def("add_columns", &pyEventFrameGen::add_double_columns)
@@ -219,15 +315,37 @@ void pyEventFrameInit(py::module &m) {
       .def("limit", [](pyEventFrameGen &s, double i) { return s.limit(i); })
       .def("norm_info", &pyEventFrameGen::norm_info)
       .def("progress", &pyEventFrameGen::progress, py::arg("every") = 100000)
+      .def("threads", &pyEventFrameGen::threads, py::arg("nthreads") = 0,
+           py::arg("batch_size") = 1000)
+      .def("cache", &pyEventFrameGen::cache, py::arg("cache_dir"),
+           py::arg("input_files"), py::arg("projection_id"))
+      .def("typed_storage", &pyEventFrameGen::typed_storage,
+           py::arg("enable") = true)
+      // the GIL is released so that worker threads can call back into python
+      // filters and projections
       .def("first", &pyEventFrameGen::first,
-           py::arg("nchunk") = std::numeric_limits<size_t>::max())
+           py::arg("nchunk") = std::numeric_limits<size_t>::max(),
+           py::call_guard<py::gil_scoped_release>())
       .def("next", &pyEventFrameGen::next,
-           py::arg("nchunk") = std::numeric_limits<size_t>::max())
+           py::arg("nchunk") = std::numeric_limits<size_t>::max(),
+           py::call_guard<py::gil_scoped_release>())
 #ifdef NUIS_ARROW_ENABLED
       .def("firstArrow", &pyEventFrameGen::firstArrow,
            py::arg("nchunk") = std::numeric_limits<size_t>::max())
       .def("nextArrow", &pyEventFrameGen::nextArrow,
            py::arg("nchunk") = std::numeric_limits<size_t>::max())
+      .def("arrowReader", &pyEventFrameGen::arrowReader,
+           py::arg("nchunk") = std::numeric_limits<size_t>::max())
+      .def("write_arrow_ipc", &pyEventFrameGen::write_arrow_ipc,
+           py::arg("path"),
+           py::arg("nchunk") = std::numeric_limits<size_t>::max(),
+           py::call_guard<py::gil_scoped_release>())
+#ifdef NUIS_PARQUET_ENABLED
+      .def("write_parquet", &pyEventFrameGen::write_parquet, py::arg("path"),
+           py::arg("row_group_size") = 1024 * 1024,
+           py::call_guard<py::gil_scoped_release>())
+#endif
 #endif
-      .def("all", &pyEventFrameGen::all);
+      .def("all", &pyEventFrameGen::all,
+           py::call_guard<py::gil_scoped_release>());
 }
@@ -69,6 +69,14 @@ struct pyEventFrameGen {
 
   pyEventFrameGen progress(size_t nmax);
 
+  pyEventFrameGen threads(size_t nthreads, size_t batch_size);
+
+  pyEventFrameGen cache(std::string const &cache_dir,
+                        std::vector<std::string> const &input_files,
+                        std::string const &projection_id);
+
+  pyEventFrameGen typed_storage(bool enable);
+
   nuis::EventFrame first(size_t nchunk);
   nuis::EventFrame next(size_t nchunk);
   nuis::EventFrame all();
@@ -76,6 +84,11 @@ struct pyEventFrameGen {
 #ifdef NUIS_ARROW_ENABLED
   pybind11::object firstArrow(size_t nchunk);
   pybind11::object nextArrow(size_t nchunk);
+  pybind11::object arrowReader(size_t nchunk);
+  void write_arrow_ipc(std::string const &path, size_t nchunk);
+#ifdef NUIS_PARQUET_ENABLED
+  void write_parquet(std::string const &path, size_t row_group_size);
+#endif
 #endif
 
   nuis::NormInfo norm_info() const;
@@ -1,5 +1,7 @@
 #include "nuis/python/pyEventInput.h"
 
+#include "nuis/eventinput/EventParticleView.h"
+
 namespace py = pybind11;
 using namespace nuis;
 
@@ -80,13 +82,67 @@ IEventSource_sentinel end(pyNormalizedEventSource &) {
   return IEventSource_sentinel();
 }
 
+// the HepMC3 python bindings only know about non-const particles
+HepMC3::GenParticlePtr as_mutable(HepMC3::ConstGenParticlePtr const &part) {
+  return std::const_pointer_cast<HepMC3::GenParticle>(part);
+}
+
+std::vector<HepMC3::GenParticlePtr>
+as_mutable(std::vector<HepMC3::ConstGenParticlePtr> const &parts) {
+  std::vector<HepMC3::GenParticlePtr> mparts;
+  mparts.reserve(parts.size());
+  for (auto const &part : parts) {
+    mparts.push_back(as_mutable(part));
+  }
+  return mparts;
+}
+
 void pyEventInputInit(py::module &m) {
 
   py::class_<NormInfo>(m, "NormInfo")
+      .def(py::init([](double fatx, double sumweights, size_t nevents) {
+             return NormInfo{fatx, sumweights, nevents};
+           }),
+           py::arg("fatx") = 0, py::arg("sumweights") = 0,
+           py::arg("nevents") = 0)
       .def_readonly("fatx", &NormInfo::fatx)
       .def_readonly("sumweights", &NormInfo::sumweights)
       .def_readonly("nevents", &NormInfo::nevents)
-      .def("fatx_per_sumweights", &NormInfo::fatx_per_sumweights);
+      .def("fatx_per_sumweights", &NormInfo::fatx_per_sumweights)
+      .def("sumweights_per_fatx", &NormInfo::sumweights_per_fatx)
+      .def("merge", &nuis::merge)
+      .def("__add__", &nuis::merge)
+      .def(py::pickle(
+          [](NormInfo const &ni) {
+            return py::make_tuple(ni.fatx, ni.sumweights, ni.nevents);
+          },
+          [](py::tuple t) {
+            return NormInfo{t[0].cast<double>(), t[1].cast<double>(),
+                            t[2].cast<size_t>()};
+          }));
+
+  // views returned by current are only valid for the duration of the filter or
+  // projection call that they were obtained in
+  py::class_<EventParticleView>(m, "EventParticleView")
+      .def(py::init<HepMC3::GenEvent const &>(), py::keep_alive<1, 2>())
+      .def("beam",
+           [](EventParticleView const &s) { return as_mutable(s.beam()); })
+      .def("target",
+           [](EventParticleView const &s) { return as_mutable(s.target()); })
+      .def("final_state",
+           [](EventParticleView const &s) {
+             return as_mutable(s.final_state());
+           })
+      .def("final_state",
+           [](EventParticleView const &s, int pid) {
+             return as_mutable(s.final_state(pid));
+           })
+      .def("highest_momentum",
+           [](EventParticleView const &s, int pid) {
+             return as_mutable(s.highest_momentum(pid));
+           })
+      .def_static("current", &EventParticleView::current,
+                  py::return_value_policy::reference);
 
   py::class_<pyNormalizedEventSource>(m, "EventSource")
       .def(py::init<std::string const &>())
@@ -122,6 +122,8 @@ void pyHistFrameInit(py::module &m) {
       .def("finalise", &HistFrame::finalise,
            py::arg("divide_by_bin_sizes") = true)
       .def("reset", &HistFrame::reset)
+      .def("merge", &HistFrame::merge, py::arg("other"),
+           py::return_value_policy::reference_internal)
       .def("__getattr__", &histframe_gettattr)
       .def("__getitem__", &histframe_gettattr)
       .def("__copy__", [](HistFrame const &self) { return HistFrame(self); })
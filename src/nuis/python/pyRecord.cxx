@@ -1,9 +1,12 @@
 #include "nuis/record/Comparison.h"
+#include "nuis/record/FrozenSelection.h"
 #include "nuis/record/IRecord.h"
 #include "nuis/record/RecordFactory.h"
 #include "nuis/record/Table.h"
 #include "nuis/record/Utility.h"
+#include "nuis/record/fill_tables.h"
 
+#include "nuis/python/pyEventInput.h"
 #include "nuis/python/pyNUISANCE.h"
 
 #include "HepMC3/GenEvent.h"
@@ -122,6 +125,33 @@ void pyRecordInit(py::module &m) {
       .def("comparison", &Table::comparison)
       .def_readwrite("likelihood", &Table::likelihood);
 
+  m.def(
+      "fill_tables",
+      [](std::vector<TablePtr> const &tables, pyNormalizedEventSource &evs,
+         size_t max_events, size_t nthreads) {
+        return fill_tables(tables, evs.evs, max_events, nthreads);
+      },
+      py::arg("tables"), py::arg("source"),
+      py::arg("max_events") = std::numeric_limits<size_t>::max(),
+      py::arg("nthreads") = 1,
+      // hooks written in python re-acquire the GIL when they are called
+      py::call_guard<py::gil_scoped_release>(),
+      "Fills and finalizes a Comparison for each table in a single pass over "
+      "the source, returns the Comparisons in the same order as the tables.");
+
+  py::class_<FrozenSelection>(m, "FrozenSelection")
+      .def(py::init([](std::vector<TablePtr> const &tables,
+                       pyNormalizedEventSource &evs, size_t max_events) {
+             return FrozenSelection(tables, evs.evs, max_events);
+           }),
+           py::arg("tables"), py::arg("source"),
+           py::arg("max_events") = std::numeric_limits<size_t>::max())
+      .def("evaluate", &FrozenSelection::evaluate,
+           py::arg("event_weight") = WeightFunc{})
+      .def("size", &FrozenSelection::size)
+      .def("__len__", &FrozenSelection::size)
+      .def("norm_info", &FrozenSelection::norm_info);
+
   //      .def_readwrite("likeihood", &Table::likeihood)
   //      .def("add_column", &Table::add_column)
   //      .def("find_column_index", &Table::find_column_index);
@@ -1,8 +1,10 @@
+#include "nuis/response/BinnedResponse.h"
 #include "nuis/response/FramedResponse.h"
 
 #include "nuis/python/pyNUISANCE.h"
 
 #include "pybind11/eigen.h"
+#include "pybind11/functional.h"
 
 namespace py = pybind11;
 using namespace nuis;
@@ -18,6 +20,7 @@ void pyResponseInit(py::module &m) {
              self.build(y);
            })
       .def("eval", &NaturalCubicFrameSplineXd::eval)
+      .def("eval_batch", &NaturalCubicFrameSplineXd::eval_batch)
       .def_readwrite("coeffs", &NaturalCubicFrameSplineXd::coeffs);
 
   py::class_<GaussRBFInterpolXd>(respmod, "GaussRBFInterpol")
@@ -30,4 +33,28 @@ void pyResponseInit(py::module &m) {
            })
       .def("eval", &GaussRBFInterpolXd::eval)
       .def_readwrite("coeffs", &GaussRBFInterpolXd::coeffs);
+
+  py::class_<BinnedSplineResponse>(respmod, "BinnedSplineResponse")
+      .def(py::init<std::vector<double> const &,
+                    std::vector<BinnedValues> const &>(),
+           py::arg("knots"), py::arg("predictions"))
+      .def(py::init<std::vector<double> const &,
+                    std::function<BinnedValues(double)> const &>(),
+           py::arg("knots"), py::arg("predict"))
+      .def("eval", &BinnedSplineResponse::eval);
+
+  py::class_<BinnedRBFResponse>(respmod, "BinnedRBFResponse")
+      .def(py::init<std::vector<std::string> const &, Eigen::ArrayXXd const &,
+                    std::vector<BinnedValues> const &>(),
+           py::arg("dial_names"), py::arg("knots"), py::arg("predictions"))
+      .def(py::init<std::vector<std::string> const &, Eigen::ArrayXXd const &,
+                    std::function<BinnedValues(
+                        Eigen::RowArrayXd const &)> const &>(),
+           py::arg("dial_names"), py::arg("knots"), py::arg("predict"))
+      .def("eval", py::overload_cast<std::map<std::string, double> const &>(
+                       &BinnedRBFResponse::eval))
+      .def("eval",
+           py::overload_cast<Eigen::RowArrayXd const &>(
+               &BinnedRBFResponse::eval))
+      .def("dial_names", &BinnedRBFResponse::get_dial_names);
 }
@@ -1,4 +1,5 @@
 #include "nuis/weightcalc/IWeightCalc.h"
+#include "nuis/weightcalc/SplineWeightCalc.h"
 #include "nuis/weightcalc/WeightCalcFactory.h"
 
 #include "nuis/weightcalc/plugins/plugins.h"
@@ -62,6 +63,22 @@ void pyWeightCalcInit(py::module &m) {
       .def(py::init<>())
       .def("make", &pyWeightCalcFactory::make);
 
+  m.def(
+      "SplineWeightCalc",
+      [](pyWeightCalc &wc, pyNormalizedEventSource &evs,
+         SplineWeightCalc::DialKnots const &dial_knots,
+         std::map<std::string, double> const &nominal_parameters,
+         size_t max_events) {
+        return pyWeightCalc(std::make_shared<SplineWeightCalc>(
+            wc.calc, evs.evs, dial_knots, nominal_parameters, max_events));
+      },
+      py::arg("weight_calc"), py::arg("source"), py::arg("dial_knots"),
+      py::arg("nominal_parameters") = std::map<std::string, double>{},
+      py::arg("max_events") = std::numeric_limits<size_t>::max(),
+      "Splines the response of weight_calc to each dial at the given knots "
+      "for every event in source, and returns a WeightCalc that evaluates "
+      "the splines.");
+
   // PS This doesn't actually build in my dev box please can we add a check?
   // Better yet could we recommend pluginss generate their own pybind
   // and we make a nuisance/pyNUISANCE/plugins/__init__.py to catch them?
@@ -0,0 +1,128 @@
+#include "nuis/record/FrozenSelection.h"
+
+#include "nuis/eventinput/EventParticleView.h"
+
+#include <cmath>
+
+namespace nuis {
+
+FrozenSelection::FrozenSelection(std::vector<TablePtr> tabs,
+                                 INormalizedEventSourcePtr evs,
+                                 size_t max_events)
+    : tables(std::move(tabs)) {
+
+  if (!evs) {
+    throw InvalidTable() << "FrozenSelection passed an invalid event source.";
+  }
+
+  // the bins are found with the tables' own HistFrames
+  auto comparisons = make_comparisons(tables);
+
+  std::vector<std::vector<uint32_t>> event_indices(tables.size());
+  std::vector<std::vector<Binning::index_t>> bins(tables.size());
+  std::vector<std::vector<double>> weights(tables.size());
+
+  std::vector<std::vector<double>> projection_buffers(tables.size());
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    projection_buffers[ti].resize(tables[ti]->projections.size());
+  }
+
+  // the limit is checked after each event, so that the loop stops before
+  // reading the next one, so a limit of 0 must skip the loop altogether
+  if (max_events) {
+    size_t nevents = 0;
+    for (auto const &[evp, cvw] : evs) {
+      auto const &ev = *evp;
+      EventParticleView::Scope view_scope(ev);
+
+      bool kept = false;
+      for (size_t ti = 0; ti < tables.size(); ++ti) {
+        auto const &tab = *tables[ti];
+
+        if (tab.select && !tab.select(ev)) {
+          continue;
+        }
+
+        Binning::index_t bin = Binning::npos;
+        if (tab.project) {
+          bin = comparisons[ti].mc.find_bin(tab.project(ev));
+        } else {
+          auto &projs = projection_buffers[ti];
+          for (size_t pi = 0; pi < projs.size(); ++pi) {
+            projs[pi] = tab.projections[pi](ev);
+          }
+          bin = comparisons[ti].mc.find_bin(projs);
+        }
+
+        double w = cvw * (tab.weight ? tab.weight(ev) : 1.0);
+
+        // would never be filled, whatever the event weight
+        if ((bin == Binning::npos) || !std::isnormal(w)) {
+          continue;
+        }
+
+        if (!kept) {
+          events.push_back(evp);
+          kept = true;
+        }
+        event_indices[ti].push_back(uint32_t(events.size() - 1));
+        bins[ti].push_back(bin);
+        weights[ti].push_back(w);
+      }
+
+      // break before the looper reads another event, so that it isn't
+      // included in the normalization
+      if (++nevents >= max_events) {
+        break;
+      }
+    }
+  }
+
+  fnorm_info = evs->norm_info();
+
+  frozen_tables.resize(tables.size());
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    auto &ft = frozen_tables[ti];
+    ft.event_indices = Eigen::Map<Eigen::Array<uint32_t, Eigen::Dynamic, 1>>(
+        event_indices[ti].data(), event_indices[ti].size());
+    ft.bins = Eigen::Map<Binning::BinIndices>(bins[ti].data(), bins[ti].size());
+    ft.weights =
+        Eigen::Map<Eigen::ArrayXd>(weights[ti].data(), weights[ti].size());
+  }
+}
+
+std::vector<Comparison>
+FrozenSelection::evaluate(WeightFunc const &event_weight) const {
+
+  auto comparisons = make_comparisons(tables);
+
+  Eigen::ArrayXd event_weights = Eigen::ArrayXd::Ones(events.size());
+  if (event_weight) {
+    for (size_t ei = 0; ei < events.size(); ++ei) {
+      event_weights[ei] = event_weight(*events[ei]);
+    }
+  }
+
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    auto const &ft = frozen_tables[ti];
+
+    Eigen::ArrayXd w(ft.weights.size());
+    for (Eigen::Index i = 0; i < w.size(); ++i) {
+      w[i] = ft.weights[i] * event_weights[ft.event_indices[i]];
+    }
+
+    comparisons[ti].mc.fill_bins(ft.bins, w, 0);
+  }
+
+  double fatx_per_sumw = fnorm_info.fatx_per_sumweights();
+
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    if (tables[ti]->finalize) {
+      tables[ti]->finalize(comparisons[ti], fatx_per_sumw);
+    }
+  }
+
+  return comparisons;
+}
+
+} // namespace nuis
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "nuis/record/fill_tables.h"
+
+#include "nuis/binning/Binning.h"
+
+#include "Eigen/Dense"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace nuis {
+
+// Runs the select, project and weight hooks of a set of tables over an event
+// source once, and keeps only what is needed to refill the tables with new
+// per-event weights: the selected events, and for each table the bin and the
+// CV weight times table weight of every selected event. Repeated evaluations,
+// e.g. the likelihood evaluations of a fit to reweighting parameters, then only
+// iterate over the selected events, without reading the source or evaluating
+// any projections again.
+//
+// Events that are not selected by any table, or that fall outside of a
+// table's binning, are not kept. Neither is an entry whose CV weight times
+// table weight is 0, or not a normal number, when the selection is frozen. Such
+// an entry is dropped for good: evaluate cannot restore it, even if
+// event_weight would give it a non-zero weight. Events that can gain weight
+// under reweighting need a non-zero CV weight.
+class FrozenSelection {
+public:
+  FrozenSelection(std::vector<TablePtr> tables, INormalizedEventSourcePtr evs,
+                  size_t max_events = std::numeric_limits<size_t>::max());
+
+  // Refills and finalizes a Comparison for each table, as fill_tables would,
+  // with each entry weighted by event_weight of its event. event_weight is
+  // called once per kept event, in the order the events were read. If
+  // event_weight is empty, the CV weights are used.
+  std::vector<Comparison> evaluate(WeightFunc const &event_weight = {}) const;
+
+  // the number of kept events
+  size_t size() const { return events.size(); }
+  NormInfo const &norm_info() const { return fnorm_info; }
+
+private:
+  std::vector<TablePtr> tables;
+  NormInfo fnorm_info;
+
+  std::vector<std::shared_ptr<HepMC3::GenEvent>> events;
+
+  struct FrozenTable {
+    // index into events of each entry
+    Eigen::Array<uint32_t, Eigen::Dynamic, 1> event_indices;
+    Binning::BinIndices bins;
+    Eigen::ArrayXd weights;
+  };
+  std::vector<FrozenTable> frozen_tables;
+};
+
+} // namespace nuis
@@ -0,0 +1,258 @@
+#include "nuis/record/fill_tables.h"
+
+#include "nuis/eventinput/EventParticleView.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace nuis {
+
+namespace {
+
+// Evaluates the hooks of every table for one event and fills the selected
+// events into hists[ti]. projection_buffers are reused by tables that only
+// have per-axis projections, so that each fill does not allocate.
+void fill_event(std::vector<TablePtr> const &tables,
+                std::vector<HistFrame *> const &hists,
+                std::vector<std::vector<double>> &projection_buffers,
+                HepMC3::GenEvent const &ev, double cvw) {
+
+  EventParticleView::Scope view_scope(ev);
+
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    auto const &tab = *tables[ti];
+
+    if (tab.select && !tab.select(ev)) {
+      continue;
+    }
+
+    double w = cvw * (tab.weight ? tab.weight(ev) : 1.0);
+
+    if (tab.project) {
+      hists[ti]->fill(tab.project(ev), w);
+    } else {
+      auto &projs = projection_buffers[ti];
+      for (size_t pi = 0; pi < projs.size(); ++pi) {
+        projs[pi] = tab.projections[pi](ev);
+      }
+      hists[ti]->fill(projs, w);
+    }
+  }
+}
+
+std::vector<std::vector<double>>
+make_projection_buffers(std::vector<TablePtr> const &tables) {
+  std::vector<std::vector<double>> projection_buffers(tables.size());
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    projection_buffers[ti].resize(tables[ti]->projections.size());
+  }
+  return projection_buffers;
+}
+
+void fill_serial(std::vector<TablePtr> const &tables,
+                 std::vector<Comparison> &comparisons,
+                 INormalizedEventSourcePtr evs, size_t max_events) {
+
+  std::vector<HistFrame *> hists;
+  for (auto &comp : comparisons) {
+    hists.push_back(&comp.mc);
+  }
+  auto projection_buffers = make_projection_buffers(tables);
+
+  size_t nevents = 0;
+  for (auto const &[evp, cvw] : evs) {
+    fill_event(tables, hists, projection_buffers, *evp, cvw);
+
+    // break before the looper reads another event, so that it isn't included
+    // in the normalization
+    if (++nevents >= max_events) {
+      break;
+    }
+  }
+}
+
+// The event source is not thread safe, so events are read on one thread and
+// handed out in batches. Batch i is always filled by worker i % nthreads, into
+// that worker's private copy of every table's HistFrame, so the result does
+// not depend on how the threads were scheduled.
+void fill_threaded(std::vector<TablePtr> const &tables,
+                   std::vector<Comparison> &comparisons,
+                   INormalizedEventSourcePtr evs, size_t max_events,
+                   size_t nthreads) {
+
+  size_t const batch_size = 1000;
+  size_t const max_queued = 2;
+
+  std::vector<HistFrame::ConcurrentFiller> fillers;
+  fillers.reserve(comparisons.size());
+  for (auto &comp : comparisons) {
+    fillers.emplace_back(comp.mc, nthreads);
+  }
+
+  using EventBatch = std::vector<EventCVWeightPair>;
+
+  std::mutex mtx;
+  std::condition_variable cv_queue, cv_work;
+  std::vector<std::deque<std::shared_ptr<EventBatch>>> to_process(nthreads);
+  bool reading = true;
+  bool stop = false;
+  std::exception_ptr err = nullptr;
+
+  auto worker = [&](size_t wi) {
+    std::vector<HistFrame *> hists;
+    for (auto &filler : fillers) {
+      hists.push_back(&filler[wi]);
+    }
+    auto projection_buffers = make_projection_buffers(tables);
+
+    while (true) {
+      std::shared_ptr<EventBatch> batch = nullptr;
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv_work.wait(lk, [&]() {
+          return stop || to_process[wi].size() || !reading;
+        });
+        if (stop || !to_process[wi].size()) {
+          return;
+        }
+        batch = to_process[wi].front();
+        to_process[wi].pop_front();
+        cv_queue.notify_all();
+      }
+
+      try {
+        for (auto const &[evp, cvw] : *batch) {
+          fill_event(tables, hists, projection_buffers, *evp, cvw);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!err) {
+          err = std::current_exception();
+        }
+        stop = true;
+        cv_queue.notify_all();
+        cv_work.notify_all();
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t wi = 0; wi < nthreads; ++wi) {
+    workers.emplace_back(worker, wi);
+  }
+
+  try {
+    auto ev_it = begin(evs);
+    auto end_it = end(evs);
+    size_t nevents = 0;
+    for (size_t seq = 0; (nevents < max_events) && (ev_it != end_it); ++seq) {
+      auto batch = std::make_shared<EventBatch>();
+      batch->reserve(batch_size);
+
+      while ((batch->size() < batch_size) && (ev_it != end_it)) {
+        batch->push_back(*ev_it);
+        // have to do this before the next loop otherwise we read one too many
+        // events
+        if (++nevents >= max_events) {
+          break;
+        }
+        ++ev_it;
+      }
+
+      auto &queue = to_process[seq % nthreads];
+      std::unique_lock<std::mutex> lk(mtx);
+      cv_queue.wait(lk, [&]() { return stop || (queue.size() < max_queued); });
+      if (stop) {
+        break;
+      }
+      queue.push_back(batch);
+      cv_work.notify_all();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!err) {
+      err = std::current_exception();
+    }
+    stop = true;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    reading = false;
+    cv_work.notify_all();
+  }
+
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  if (err) {
+    std::rethrow_exception(err);
+  }
+
+  for (auto &filler : fillers) {
+    filler.merge();
+  }
+}
+
+} // namespace
+
+std::vector<Comparison> make_comparisons(std::vector<TablePtr> const &tables) {
+  std::vector<Comparison> comparisons;
+  comparisons.reserve(tables.size());
+
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    auto const &tab = tables[ti];
+    if (!tab || !tab->blueprint) {
+      throw InvalidTable() << "Table " << ti << " has no blueprint Comparison.";
+    }
+    if (!tab->project && tab->projections.empty()) {
+      throw InvalidTable() << "Table " << ti << " has no projection hooks.";
+    }
+
+    comparisons.push_back(tab->comparison());
+    if (tab->clear) {
+      tab->clear(comparisons.back());
+    } else {
+      comparisons.back().reset();
+    }
+  }
+
+  return comparisons;
+}
+
+std::vector<Comparison> fill_tables(std::vector<TablePtr> const &tables,
+                                    INormalizedEventSourcePtr evs,
+                                    size_t max_events, size_t nthreads) {
+
+  if (!evs) {
+    throw InvalidTable() << "fill_tables passed an invalid event source.";
+  }
+
+  auto comparisons = make_comparisons(tables);
+
+  // both fill loops only check the limit after filling an event, so that they
+  // stop before reading the next one, which would otherwise be included in the
+  // normalization. So a limit of 0 has to be handled here.
+  if (max_events && (nthreads > 1)) {
+    fill_threaded(tables, comparisons, evs, max_events, nthreads);
+  } else if (max_events) {
+    fill_serial(tables, comparisons, evs, max_events);
+  }
+
+  double fatx_per_sumw = evs->norm_info().fatx_per_sumweights();
+
+  for (size_t ti = 0; ti < tables.size(); ++ti) {
+    if (tables[ti]->finalize) {
+      tables[ti]->finalize(comparisons[ti], fatx_per_sumw);
+    }
+  }
+
+  return comparisons;
+}
+
+} // namespace nuis
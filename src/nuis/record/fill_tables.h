@@ -0,0 +1,46 @@
+#pragma once
+
+#include "nuis/record/IRecord.h"
+
+#include "nuis/eventinput/INormalizedEventSource.h"
+
+#include "nuis/except.h"
+
+#include <limits>
+#include <vector>
+
+namespace nuis {
+
+NEW_NUISANCE_EXCEPT(InvalidTable);
+
+// Checks that every table has a blueprint and a projection hook, and returns a
+// copy of each table's blueprint Comparison that has been cleared with the
+// table's clear hook, or Comparison::reset if it has none.
+std::vector<Comparison> make_comparisons(std::vector<TablePtr> const &tables);
+
+// Fills a Comparison for each of tables in a single pass over evs, rather than
+// one pass per table. For every event, each table's select hook is called and,
+// for selected events, its project and weight hooks are used to fill
+// Comparison::mc with the product of the event's CV weight and the table
+// weight. Once the events are exhausted, or max_events events have been read,
+// each table's finalize hook is called with the flux-averaged total cross
+// section per sum of weights of the sample, which is the same normalization
+// that a hand-written loop over evs would pass.
+//
+// Missing hooks fall back to the defaults used by the record plugins: every
+// event is selected, the projection is built from Table::projections, the
+// table weight is 1, and Comparison::estimate is left empty if there is no
+// finalize hook.
+//
+// If nthreads > 1, events are read on the calling thread and filled on
+// nthreads worker threads, each of which fills its own copy of every table's
+// HistFrame. The copies are merged before finalizing. The table hooks must then
+// be safe to call concurrently, which stateless ProSelecta functions are.
+//
+// Returns the comparisons in the same order as tables.
+std::vector<Comparison>
+fill_tables(std::vector<TablePtr> const &tables, INormalizedEventSourcePtr evs,
+            size_t max_events = std::numeric_limits<size_t>::max(),
+            size_t nthreads = 1);
+
+} // namespace nuis
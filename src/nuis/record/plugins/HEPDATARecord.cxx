@@ -1,5 +1,8 @@
+#include "nuis/binning/BinExtentsIndex.h"
 #include "nuis/binning/Binning.h"
 
+#include "nuis/eventinput/EventParticleView.h"
+
 #include "nuis/record/Utility.h"
 #include "nuis/record/plugins/IRecordPlugin.h"
 
@@ -31,8 +34,8 @@ std::vector<std::string> ps_paths;
 
 // The functions for binning are pretty opaque to new users. I think comments
 // need to label these as the efficient implementations and some simple
-// examples. For now to make sure things are working I'm adding a HEPData brute
-// force search one so we can be sure its working.
+// examples. HEPData bins are looked up with a BinExtentsIndex, which gives the
+// same answer as a brute force search over the bins.
 nuis::BinningPtr from_hepdata_extents(std::vector<Variables> &axes) {
 
   nuis::BinningPtr bin_info = std::make_shared<nuis::Binning>();
@@ -53,37 +56,47 @@ nuis::BinningPtr from_hepdata_extents(std::vector<Variables> &axes) {
     }
   }
 
+  // HEPData tables are not checked for overlaps, but the index returns the
+  // first matching bin just like a linear search would.
+  auto index = std::make_shared<nuis::BinExtentsIndex const>(bins);
+
   // be careful not to let the lambda capture bin_info or it will create a
   // circular reference and a memory leak
   bin_info->binning_function =
       [=](std::vector<double> const &x) -> Binning::index_t {
-    for (size_t i = 0; i < bins.size(); i++) {
-      auto const &bin_info_slice = bins[i];
-
-      bool goodbin = true;
-      for (size_t j = 0; j < bin_info_slice.size(); j++) {
-        if (x[j] < bin_info_slice[j].low) {
-          goodbin = false;
-          break;
-        }
-        if (x[j] >= bin_info_slice[j].high) {
-          goodbin = false;
-          break;
-        }
-      }
-      if (!goodbin) {
-        continue;
-      }
-      return i;
-    }
-    return Binning::npos;
+    return (*index)(x);
   };
+  bin_info->batch_binning_function = [=](Binning::ProjectionsRef const &x,
+                                         Binning::BinIndices &bins_out) {
+    (*index)(x, bins_out);
+  };
+
   bin_info->bins = bins;
   return bin_info;
 }
 
 namespace nuis {
 
+// Tables from the same release often share a selection or projection function
+// and the ProSelecta functions walk the particle list on every call, so their
+// results are memoized in the per-event EventParticleView. The scope reuses
+// the event loop's view when there is one.
+SelectFunc memoized_select(SelectFunc sel, std::string const &name) {
+  auto key = EventParticleView::memo_key(name);
+  return [=](HepMC3::GenEvent const &ev) {
+    EventParticleView::Scope scope(ev);
+    return int(scope.get().memoized(key, [&]() { return sel(ev); }));
+  };
+}
+
+ProjectFunc memoized_projection(ProjectFunc proj, std::string const &name) {
+  auto key = EventParticleView::memo_key(name);
+  return [=](HepMC3::GenEvent const &ev) {
+    EventParticleView::Scope scope(ev);
+    return scope.get().memoized(key, [&]() { return proj(ev); });
+  };
+}
+
 NEW_NUISANCE_EXCEPT(HepDataDirDoesNotExist);
 NEW_NUISANCE_EXCEPT(InvalidTableForRecord);
 NEW_NUISANCE_EXCEPT(ProSelectaload_fileFailure);
@@ -221,6 +234,7 @@ public:
                 << std::endl;
       throw ProSelectaGetFilterFailure();
     }
+    tab.select = memoized_select(tab.select, "hepdata:select:" + filter_name);
 
     std::vector<std::string> projection_names;
     for (auto const &iv : variables_indep) {
@@ -232,7 +246,8 @@ public:
           pn, ProSelecta::Interpreter::kCling);
 
       if (pjf) {
-        tab.projections.emplace_back(pjf);
+        tab.projections.emplace_back(
+            memoized_projection(pjf, "hepdata:project:" + pn));
       } else {
         std::cerr << "[ERROR]: Cling didn't find a projection function named: "
                   << pn << " in the input file. Skipping." << std::endl;
@@ -0,0 +1,155 @@
+#include "nuis/response/BinnedResponse.h"
+
+#include "fmt/core.h"
+
+namespace nuis {
+
+namespace {
+
+// One row per bin and column of the values, followed by one row per bin and
+// column of the errors, and one column per prediction.
+Eigen::ArrayXXd
+stack_predictions(std::vector<BinnedValues> const &predictions) {
+
+  if (!predictions.size()) {
+    throw InvalidBinnedPrediction() << "Tried to build a binned response "
+                                       "without any predictions.";
+  }
+
+  auto const &first = predictions.front();
+  Eigen::Index nvals = first.values.size();
+
+  // predictions filled from separately built Binnings are still compatible
+  auto same_bins = [&](BinningPtr const &b) {
+    return (b == first.binning) ||
+           (b && first.binning && (b->bins == first.binning->bins));
+  };
+
+  Eigen::ArrayXXd yvals(2 * nvals, predictions.size());
+  for (size_t i = 0; i < predictions.size(); ++i) {
+    auto const &pred = predictions[i];
+    if (!same_bins(pred.binning) ||
+        (pred.values.rows() != first.values.rows()) ||
+        (pred.values.cols() != first.values.cols()) ||
+        (pred.errors.size() != nvals)) {
+      throw InvalidBinnedPrediction() << fmt::format(
+          "Binned response prediction {} has a {}x{} values matrix, but "
+          "prediction 0 has a {}x{} values matrix, or they have different "
+          "bin extents.",
+          i, pred.values.rows(), pred.values.cols(), first.values.rows(),
+          first.values.cols());
+    }
+
+    yvals.col(i).head(nvals) =
+        Eigen::Map<Eigen::ArrayXd const>(pred.values.data(), nvals);
+    yvals.col(i).tail(nvals) =
+        Eigen::Map<Eigen::ArrayXd const>(pred.errors.data(), nvals);
+  }
+  return yvals;
+}
+
+BinnedValues unstack_prediction(BinnedValues const &blueprint,
+                                Eigen::ArrayXd const &ys) {
+  BinnedValues bv = blueprint;
+  Eigen::Index nvals = bv.values.size();
+  Eigen::Map<Eigen::ArrayXd>(bv.values.data(), nvals) = ys.head(nvals);
+  // the interpolated errors may undershoot zero between knots
+  Eigen::Map<Eigen::ArrayXd>(bv.errors.data(), nvals) =
+      ys.tail(nvals).max(0.0);
+  return bv;
+}
+
+} // namespace
+
+BinnedSplineResponse::BinnedSplineResponse(
+    std::vector<double> const &knots,
+    std::vector<BinnedValues> const &predictions) {
+
+  if (knots.size() < 3) {
+    throw InvalidBinnedPrediction()
+        << "BinnedSplineResponse passed " << knots.size()
+        << " knots, but at least 3 are required.";
+  }
+
+  if (knots.size() != predictions.size()) {
+    throw InvalidBinnedPrediction()
+        << "BinnedSplineResponse passed " << knots.size() << " knots and "
+        << predictions.size() << " predictions.";
+  }
+
+  auto yvals = stack_predictions(predictions);
+  blueprint = predictions.front();
+  spline = NaturalCubicFrameSplineXd(Eigen::ColArrayXd(
+      Eigen::Map<Eigen::ColArrayXd const>(knots.data(), knots.size())));
+  spline.build(yvals);
+}
+
+BinnedSplineResponse::BinnedSplineResponse(
+    std::vector<double> const &knots,
+    std::function<BinnedValues(double)> const &predict)
+    : BinnedSplineResponse(knots, [&]() {
+        std::vector<BinnedValues> predictions;
+        for (auto k : knots) {
+          predictions.push_back(predict(k));
+        }
+        return predictions;
+      }()) {}
+
+BinnedValues BinnedSplineResponse::eval(double x) {
+  return unstack_prediction(blueprint, spline.eval(x));
+}
+
+BinnedRBFResponse::BinnedRBFResponse(
+    std::vector<std::string> const &dnames, Eigen::ArrayXXd const &knots,
+    std::vector<BinnedValues> const &predictions)
+    : dial_names(dnames) {
+
+  if (size_t(knots.cols()) != dial_names.size()) {
+    throw InvalidBinnedPrediction()
+        << "BinnedRBFResponse passed " << dial_names.size()
+        << " dial names and knots for " << knots.cols() << " dials.";
+  }
+
+  if (size_t(knots.rows()) != predictions.size()) {
+    throw InvalidBinnedPrediction()
+        << "BinnedRBFResponse passed " << knots.rows() << " knots and "
+        << predictions.size() << " predictions.";
+  }
+
+  auto yvals = stack_predictions(predictions);
+  blueprint = predictions.front();
+  rbf = GaussRBFInterpolXd(knots);
+  rbf.build(yvals);
+}
+
+BinnedRBFResponse::BinnedRBFResponse(
+    std::vector<std::string> const &dnames, Eigen::ArrayXXd const &knots,
+    std::function<BinnedValues(Eigen::RowArrayXd const &)> const &predict)
+    : BinnedRBFResponse(dnames, knots, [&]() {
+        std::vector<BinnedValues> predictions;
+        for (Eigen::Index i = 0; i < knots.rows(); ++i) {
+          predictions.push_back(predict(knots.row(i)));
+        }
+        return predictions;
+      }()) {}
+
+BinnedValues BinnedRBFResponse::eval(Eigen::RowArrayXd const &params) {
+  return unstack_prediction(blueprint, rbf.eval(params));
+}
+
+BinnedValues
+BinnedRBFResponse::eval(std::map<std::string, double> const &params) {
+  Eigen::RowArrayXd pvals(dial_names.size());
+  for (size_t i = 0; i < dial_names.size(); ++i) {
+    auto p = params.find(dial_names[i]);
+    if (p == params.end()) {
+      throw InvalidBinnedPrediction()
+          << "BinnedRBFResponse::eval passed no value for dial "
+          << dial_names[i];
+    }
+    pvals[i] = p->second;
+  }
+  return eval(pvals);
+}
+
+} // namespace nuis
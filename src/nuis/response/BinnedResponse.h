@@ -0,0 +1,66 @@
+#pragma once
+
+#include "nuis/response/FramedResponse.h"
+
+#include "nuis/histframe/BinnedValues.h"
+
+#include "nuis/except.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nuis {
+
+NEW_NUISANCE_EXCEPT(InvalidBinnedPrediction);
+
+// Interpolates a binned prediction, e.g. a finalised HistFrame, in one dial.
+// The values and errors of every bin and column are splined through the
+// predictions at each knot with a NaturalCubicFrameSpline, one frame row per
+// bin, so that a prediction at a new dial value needs no event loop.
+//
+// All predictions must have the same bin extents and number of columns. eval
+// can only be called within the knot range.
+class BinnedSplineResponse {
+public:
+  BinnedSplineResponse(std::vector<double> const &knots,
+                       std::vector<BinnedValues> const &predictions);
+  // calls predict once for each knot
+  BinnedSplineResponse(std::vector<double> const &knots,
+                       std::function<BinnedValues(double)> const &predict);
+
+  BinnedValues eval(double x);
+
+private:
+  BinnedValues blueprint;
+  NaturalCubicFrameSplineXd spline;
+};
+
+// As BinnedSplineResponse, but for any number of dials, by interpolating the
+// predictions at a set of parameter points with a GaussRBFInterpol. knots has
+// one row per parameter point and one column per dial in dial_names.
+class BinnedRBFResponse {
+public:
+  BinnedRBFResponse(std::vector<std::string> const &dial_names,
+                    Eigen::ArrayXXd const &knots,
+                    std::vector<BinnedValues> const &predictions);
+  // calls predict once for each row of knots
+  BinnedRBFResponse(
+      std::vector<std::string> const &dial_names, Eigen::ArrayXXd const &knots,
+      std::function<BinnedValues(Eigen::RowArrayXd const &)> const &predict);
+
+  // params has one entry per dial, in the order of dial_names
+  BinnedValues eval(Eigen::RowArrayXd const &params);
+  // every dial must have a value in params
+  BinnedValues eval(std::map<std::string, double> const &params);
+
+  std::vector<std::string> const &get_dial_names() const { return dial_names; }
+
+private:
+  std::vector<std::string> dial_names;
+  BinnedValues blueprint;
+  GaussRBFInterpolXd rbf;
+};
+
+} // namespace nuis
@@ -4,6 +4,8 @@
 #include "nuis/eventframe/column_types.h"
 #endif
 
+#include "nuis/except.h"
+
 #include "Eigen/Dense"
 
 #include <array>
@@ -25,6 +27,16 @@ using ArrayXXCRef = Ref<Eigen::Array<P, Dynamic, Dynamic> const, 0,
 
 namespace nuis {
 
+NEW_NUISANCE_EXCEPT(EvalOutOfValidityRange);
+NEW_NUISANCE_EXCEPT(InvalidYVals);
+NEW_NUISANCE_EXCEPT(InvalidNumParameters);
+
+// One natural cubic spline through the knots for each row of a frame.
+//
+// coeffs has one row per frame row and is grouped by knot segment: columns
+// 4i to 4i + 3 hold the a, b, c, and d coefficients of segment i, which starts
+// at knot i, such that each segment is one contiguous block and evaluation
+// vectorizes across rows.
 template <int N = Eigen::Dynamic, typename P = float>
 struct NaturalCubicFrameSpline {
 
@@ -45,7 +57,17 @@ struct NaturalCubicFrameSpline {
     build(yvals.template cast<P>());
   }
 
-  Eigen::ColArrayX<P> eval(P val);
+  // evaluates every row at val
+  Eigen::ColArrayX<P> eval(P val) const;
+  // evaluates every row at val into out, which must have a row per frame row
+  void eval_into(P val, Eigen::Ref<Eigen::ColArrayX<P>> out) const;
+  // evaluates every row at each of vals, with one column per value
+  Eigen::ArrayXX<P>
+  eval_batch(Eigen::Ref<Eigen::ColArrayX<P> const> vals) const;
+
+  // the segment that val falls in, throws EvalOutOfValidityRange if val is
+  // outside of the knots
+  int find_segment(P val) const;
 };
 
 using NaturalCubicFrameSpline3d = NaturalCubicFrameSpline<3, double>;
@@ -2,18 +2,20 @@
 
 #include "nuis/response/FramedResponse.h"
 
-#include "nuis/except.h"
-
 #include "fmt/core.h"
 
-namespace nuis {
+#include <algorithm>
+#include <vector>
 
-NEW_NUISANCE_EXCEPT(EvalOutOfValidityRange);
-NEW_NUISANCE_EXCEPT(InvalidYVals);
-NEW_NUISANCE_EXCEPT(InvalidNumParameters);
+namespace nuis {
 
 // from
 // https://people.clas.ufl.edu/kees/files/CubicSplines.pdf
+//
+// The second derivative coefficients, c, solve a tridiagonal system that only
+// depends on the knots. It is factorized once with the Thomas algorithm and the
+// forward and back substitutions are carried out for all rows at once, one
+// knot column at a time.
 template <int N, typename P>
 void NaturalCubicFrameSpline<N, P>::build(Eigen::ArrayXXCRef<P> yvals) {
 
@@ -24,162 +26,114 @@ void NaturalCubicFrameSpline<N, P>::build(Eigen::ArrayXXCRef<P> yvals) {
         N, knot_x.size(), yvals.cols());
   }
 
-  if constexpr (N == Eigen::Dynamic) {
-    int num_knots = knot_x.size();
+  int num_knots = knot_x.size();
+  Eigen::Index nrows = yvals.rows();
+
+  Eigen::ArrayXd h = (knot_x.tail(num_knots - 1) - knot_x.head(num_knots - 1))
+                         .template cast<double>();
+
+  // the natural boundary conditions fix c at the first and last knots to 0, so
+  // only the interior rows of the system need eliminating. upper holds the
+  // modified super-diagonal and inv_diag the reciprocal of the modified
+  // diagonal.
+  Eigen::ArrayXd upper = Eigen::ArrayXd::Zero(num_knots);
+  Eigen::ArrayXd inv_diag = Eigen::ArrayXd::Zero(num_knots);
+  for (int i = 1; i < (num_knots - 1); ++i) {
+    inv_diag(i) = 1.0 / (2.0 * (h(i - 1) + h(i)) - h(i - 1) * upper(i - 1));
+    upper(i) = h(i) * inv_diag(i);
+  }
 
-    coeffs = Eigen::ArrayXX<P>::Zero(yvals.rows(), 4 * (num_knots - 1));
+  Eigen::ArrayXXd y = yvals.template cast<double>();
+  Eigen::ArrayXXd c = Eigen::ArrayXXd::Zero(nrows, num_knots);
 
-    Eigen::RowArrayXd h =
-        (knot_x.tail(num_knots - 1) - knot_x.head(num_knots - 1))
-            .template cast<double>();
-    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(num_knots, num_knots);
+  // forward substitution, column i of c holds the right hand side of the
+  // eliminated system
+  for (int i = 1; i < (num_knots - 1); ++i) {
+    c.col(i) = ((3.0 / h(i)) * (y.col(i + 1) - y.col(i)) -
+                (3.0 / h(i - 1)) * (y.col(i) - y.col(i - 1)) -
+                h(i - 1) * c.col(i - 1)) *
+               inv_diag(i);
+  }
 
-    for (int i = 0; i < num_knots; ++i) {
-      for (int j = 0; j < num_knots; ++j) {
-        if (i == j) {
+  // back substitution
+  for (int i = num_knots - 3; i > 0; --i) {
+    c.col(i) -= upper(i) * c.col(i + 1);
+  }
 
-          if ((i == 0) || ((i + 1) == num_knots)) {
-            A(i, j) = 1;
-          } else {
-            A(i, j) = 2.0 * (h(i - 1) + h(i));
-          }
+  coeffs.resize(nrows, 4 * (num_knots - 1));
+  for (int seg = 0; seg < (num_knots - 1); ++seg) {
+    coeffs.col(4 * seg) = yvals.col(seg);
+    coeffs.col(4 * seg + 1) =
+        ((y.col(seg + 1) - y.col(seg)) / h(seg) -
+         (h(seg) / 3.0) * (2.0 * c.col(seg) + c.col(seg + 1)))
+            .template cast<P>();
+    coeffs.col(4 * seg + 2) = c.col(seg).template cast<P>();
+    coeffs.col(4 * seg + 3) =
+        ((c.col(seg + 1) - c.col(seg)) / (3.0 * h(seg))).template cast<P>();
+  }
+}
 
-        } else if (((i + 1) == j) && (i != 0)) { // upper diag
-          A(i, j) = h(i);
-        } else if (((i - 1) == j) && ((i + 1) != num_knots)) { // lower diag
-          A(i, j) = h(i - 1);
-        }
-      }
-    }
+template <int N, typename P>
+int NaturalCubicFrameSpline<N, P>::find_segment(P val) const {
 
-    Eigen::RowArrayXd b, d;
-    Eigen::RowArrayXd c;
-
-    Eigen::ColArrayXd alpha = Eigen::RowArrayXd::Zero(num_knots);
-
-    for (int row = 0; row < yvals.rows(); ++row) {
-
-      // solve Ac = alpha for c, where alpha
-      alpha.segment(1, num_knots - 2) =
-          (3.0 / h.tail(num_knots - 2)) *
-              (yvals.row(row).tail(num_knots - 2) -
-               yvals.row(row).segment(1, num_knots - 2))
-                  .template cast<double>() -
-          (3.0 / h.head(num_knots - 2)) *
-              (yvals.row(row).segment(1, num_knots - 2) -
-               yvals.row(row).head(num_knots - 2))
-                  .template cast<double>();
-
-      // solve for c
-      c = A.colPivHouseholderQr().solve(alpha.matrix()).array();
-
-      d = (c.tail(num_knots - 1) - c.head(num_knots - 1)) / (3.0 * h);
-      b = ((yvals.row(row).tail(num_knots - 1) -
-            yvals.row(row).head(num_knots - 1))
-               .template cast<double>() /
-           h) -
-          ((h / 3.0) * (2.0 * c.head(num_knots - 1) + c.tail(num_knots - 1)));
-
-      coeffs.row(row).segment(0, num_knots - 1) =
-          yvals.row(row).head(num_knots - 1).template cast<P>();
-      coeffs.row(row).segment(num_knots - 1, num_knots - 1) = b.cast<P>();
-      coeffs.row(row).segment(2 * (num_knots - 1), num_knots - 1) =
-          c.head(num_knots - 1).cast<P>();
-      coeffs.row(row).segment(3 * (num_knots - 1), num_knots - 1) = d.cast<P>();
-    }
+  int num_knots = knot_x.size();
 
-  } else {
+  // the first knot after val
+  int i = int(std::upper_bound(knot_x.data(), knot_x.data() + num_knots, val) -
+              knot_x.data());
 
-    coeffs = Eigen::ArrayXX<P>::Zero(yvals.rows(), 4 * (N - 1));
+  if ((i == 0) || ((i == num_knots) && (val != knot_x[num_knots - 1]))) {
+    throw EvalOutOfValidityRange()
+        << "eval passed " << val << ", but validity range: " << knot_x[0]
+        << " -- " << knot_x[num_knots - 1];
+  }
 
-    Eigen::RowArray<N - 1, double> h =
-        (knot_x.template tail<N - 1>() - knot_x.template head<N - 1>())
-            .template cast<double>();
-    Eigen::Matrix<double, N, N> A = Eigen::Array<double, N, N>::Zero();
+  // the last knot is the end of the last segment
+  return std::min(i, num_knots - 1) - 1;
+}
 
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < N; ++j) {
-        if (i == j) {
+template <int N, typename P>
+void NaturalCubicFrameSpline<N, P>::eval_into(
+    P val, Eigen::Ref<Eigen::ColArrayX<P>> out) const {
 
-          if ((i == 0) || ((i + 1) == N)) {
-            A(i, j) = 1;
-          } else {
-            A(i, j) = 2.0 * (h(i - 1) + h(i));
-          }
+  int seg = find_segment(val);
+  P t = val - knot_x[seg];
 
-        } else if (((i + 1) == j) && (i != 0)) { // upper diag
-          A(i, j) = h(i);
-        } else if (((i - 1) == j) && ((i + 1) != N)) { // lower diag
-          A(i, j) = h(i - 1);
-        }
-      }
-    }
+  P t2 = t * t, t3 = t2 * t;
 
-    Eigen::RowArray<N - 1, double> b, d;
-    Eigen::RowArray<N, double> c;
-
-    Eigen::ColArray<N, double> alpha = Eigen::RowArray<N, double>::Zero();
-
-    for (int row = 0; row < yvals.rows(); ++row) {
-
-      // solve Ac = alpha for c, where alpha
-      alpha.template segment<N - 2>(1) =
-          (3.0 / h.template tail<N - 2>()) *
-              (yvals.row(row).template tail<N - 2>() -
-               yvals.row(row).template segment<N - 2>(1))
-                  .template cast<double>() -
-          (3.0 / h.template head<N - 2>()) *
-              (yvals.row(row).template segment<N - 2>(1) -
-               yvals.row(row).template head<N - 2>())
-                  .template cast<double>();
-
-      // solve for c
-      c = A.colPivHouseholderQr().solve(alpha.matrix()).array();
-
-      d = (c.template tail<N - 1>() - c.template head<N - 1>()) / (3.0 * h);
-      b = ((yvals.row(row).template tail<N - 1>() -
-            yvals.row(row).template head<N - 1>())
-               .template cast<double>() /
-           h) -
-          ((h / 3.0) *
-           (2.0 * c.template head<N - 1>() + c.template tail<N - 1>()));
-
-      coeffs.row(row).template segment<N - 1>(0) =
-          yvals.row(row).template head<N - 1>().template cast<P>();
-      coeffs.row(row).template segment<N - 1>(N - 1) = b.template cast<P>();
-      coeffs.row(row).template segment<N - 1>(2 * (N - 1)) =
-          c.template head<N - 1>().template cast<P>();
-      coeffs.row(row).template segment<N - 1>(3 * (N - 1)) =
-          d.template cast<P>();
-    }
-  }
+  // a single pass over the four contiguous columns, the powers of t are
+  // computed once so that the multiply-adds for each row are independent
+  out = coeffs.col(4 * seg) + t * coeffs.col(4 * seg + 1) +
+        t2 * coeffs.col(4 * seg + 2) + t3 * coeffs.col(4 * seg + 3);
 }
 
 template <int N, typename P>
-Eigen::ColArrayX<P> NaturalCubicFrameSpline<N, P>::eval(P val) {
+Eigen::ColArrayX<P> NaturalCubicFrameSpline<N, P>::eval(P val) const {
+  Eigen::ColArrayX<P> out(coeffs.rows());
+  eval_into(val, out);
+  return out;
+}
 
-  int num_knots = N;
-  if constexpr (N == Eigen::Dynamic) {
-    num_knots = knot_x.size();
-  }
+template <int N, typename P>
+Eigen::ArrayXX<P> NaturalCubicFrameSpline<N, P>::eval_batch(
+    Eigen::Ref<Eigen::ColArrayX<P> const> vals) const {
 
-  int i = 0;
-  for (; i < (num_knots - 1); ++i) {
-    if ((knot_x[i] <= val) && (val < knot_x[i + 1])) {
-      break;
-    }
-  }
-  if ((i == (num_knots - 1)) && (val != knot_x[num_knots - 1])) {
-    throw EvalOutOfValidityRange()
-        << "eval passed " << val << ", but validity range: " << knot_x[0]
-        << " -- " << knot_x[num_knots - 1];
+  Eigen::Index nrows = coeffs.rows();
+  Eigen::Index nvals = vals.size();
+
+  Eigen::ArrayXX<P> out(nrows, nvals);
+
+  // check all of the values before doing any work
+  for (Eigen::Index j = 0; j < nvals; ++j) {
+    find_segment(vals[j]);
   }
 
-  P past_knot = val - knot_x[i];
+  // each value writes one contiguous column of out
+  for (Eigen::Index j = 0; j < nvals; ++j) {
+    eval_into(vals[j], out.col(j));
+  }
 
-  return coeffs.col(i) + past_knot * coeffs.col((num_knots - 1) + i) +
-         std::pow(past_knot, 2) * coeffs.col(2 * (num_knots - 1) + i) +
-         std::pow(past_knot, 3) * coeffs.col(3 * (num_knots - 1) + i);
+  return out;
 }
 
 // from
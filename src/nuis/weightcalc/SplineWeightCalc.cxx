@@ -0,0 +1,176 @@
+#include "nuis/weightcalc/SplineWeightCalc.h"
+
+#include "nuis/log.txx"
+
+#include <algorithm>
+#include <iterator>
+
+namespace nuis {
+
+SplineWeightCalc::SplineWeightCalc(IWeightCalcHM3MapPtr wc,
+                                   INormalizedEventSourcePtr evs,
+                                   DialKnots const &dial_knots,
+                                   ParamType const &nominal_parameters,
+                                   size_t max_events, size_t batch_size) {
+
+  if (!wc || !evs) {
+    throw InvalidSplineDial()
+        << "SplineWeightCalc passed an invalid weight calculator or event "
+           "source.";
+  }
+
+  ParamType nominal;
+  for (auto const &[name, knots] : dial_knots) {
+    if (knots.size() < 3) {
+      throw InvalidSplineDial()
+          << "SplineWeightCalc dial " << name << " has " << knots.size()
+          << " knots, but at least 3 are required.";
+    }
+    if (std::adjacent_find(knots.begin(), knots.end(),
+                           std::greater_equal<double>()) != knots.end()) {
+      throw InvalidSplineDial() << "SplineWeightCalc dial " << name
+                                << " knots must be strictly increasing.";
+    }
+    nominal[name] =
+        nominal_parameters.count(name) ? nominal_parameters.at(name) : 0;
+    // set_parameters fixes the ratio at the nominal value to 1, which is only
+    // continuous with the spline if it passes through a knot there
+    if (std::find(knots.begin(), knots.end(), nominal[name]) == knots.end()) {
+      throw InvalidSplineDial()
+          << "SplineWeightCalc dial " << name << " nominal value "
+          << nominal[name] << " is not one of its knots.";
+    }
+    dials.push_back(SplinedDial{
+        name, nominal[name], nominal[name],
+        NaturalCubicFrameSplineXf(Eigen::ColArrayXd(
+            Eigen::Map<Eigen::ColArrayXd const>(knots.data(), knots.size())))});
+  }
+
+  // row-major, one row of weight ratios at each knot per event, for each dial
+  std::vector<std::vector<double>> ratios(dials.size());
+  std::vector<double> nominal_ws;
+
+  std::vector<std::shared_ptr<HepMC3::GenEvent>> batch;
+  batch.reserve(batch_size);
+
+  // each batch of events is evaluated at one parameter point after another,
+  // so that the reweighting engine is only reconfigured a few times per batch
+  auto process_batch = [&]() {
+    size_t first_row = nominal_ws.size();
+
+    wc->set_parameters(nominal);
+    for (auto const &ev : batch) {
+      if (!event_rows.emplace(ev->event_number(), nominal_ws.size()).second) {
+        throw SplineWeightCalcDuplicateEvent()
+            << "SplineWeightCalc read more than one event with event number "
+            << ev->event_number()
+            << ", events are matched by event number so it must be unique.";
+      }
+      nominal_ws.push_back(wc->calc_weight(*ev));
+    }
+
+    for (size_t di = 0; di < dials.size(); ++di) {
+      auto const &knots = dial_knots.at(dials[di].name);
+      size_t nknots = knots.size();
+      ratios[di].resize(nominal_ws.size() * nknots);
+
+      for (size_t ki = 0; ki < nknots; ++ki) {
+        auto params = nominal;
+        params[dials[di].name] = knots[ki];
+        wc->set_parameters(params);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+          double w0 = nominal_ws[first_row + i];
+          ratios[di][(first_row + i) * nknots + ki] =
+              (w0 != 0) ? (wc->calc_weight(*batch[i]) / w0) : 1;
+        }
+      }
+    }
+
+    batch.clear();
+  };
+
+  // the limit is checked after each event, so that the loop stops before
+  // reading the next one, so a limit of 0 must skip the loop altogether
+  if (max_events) {
+    size_t nevents = 0;
+    for (auto const &[evp, cvw] : evs) {
+      batch.push_back(evp);
+      if (batch.size() == batch_size) {
+        process_batch();
+      }
+
+      // break before the looper reads another event
+      if (++nevents >= max_events) {
+        break;
+      }
+    }
+  }
+  if (batch.size()) {
+    process_batch();
+  }
+
+  wc->set_parameters(nominal);
+
+  for (size_t di = 0; di < dials.size(); ++di) {
+    Eigen::Index nknots = dials[di].spline.knot_x.size();
+    dials[di].spline.build(
+        Eigen::Map<Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic,
+                                Eigen::RowMajor> const>(
+            ratios[di].data(), nominal_ws.size(), nknots)
+            .cast<float>());
+  }
+
+  nominal_weights =
+      Eigen::Map<Eigen::ArrayXd const>(nominal_ws.data(), nominal_ws.size());
+  weights = nominal_weights;
+
+  log_info("SplineWeightCalc built splines for {} dials from {} events.",
+           dials.size(), nominal_weights.size());
+}
+
+double SplineWeightCalc::calc_weight(HepMC3::GenEvent const &ev) {
+  auto row = event_rows.find(ev.event_number());
+  if (row == event_rows.end()) {
+    throw SplineWeightCalcUnknownEvent()
+        << "SplineWeightCalc has no splines for event number "
+        << ev.event_number();
+  }
+  return weights[row->second];
+}
+
+void SplineWeightCalc::set_parameters(ParamType const &params) {
+  std::vector<double> values;
+  for (auto const &dial : dials) {
+    values.push_back(dial.value);
+  }
+
+  for (auto const &[name, val] : params) {
+    auto dial = std::find_if(dials.begin(), dials.end(),
+                             [&](auto const &d) { return d.name == name; });
+    if (dial == dials.end()) {
+      throw InvalidSplineDial()
+          << "SplineWeightCalc passed parameter " << name
+          << " which was not splined.";
+    }
+    values[std::distance(dials.begin(), dial)] = val;
+  }
+
+  // the state is only updated once every dial has been evaluated, so that a
+  // value outside of the knot range leaves the previous parameters in place
+  Eigen::ArrayXd new_weights = nominal_weights;
+  for (size_t di = 0; di < dials.size(); ++di) {
+    // the ratio at the nominal value is exactly 1
+    if (values[di] == dials[di].nominal) {
+      continue;
+    }
+    new_weights *= dials[di].spline.eval(float(values[di])).cast<double>();
+  }
+
+  for (size_t di = 0; di < dials.size(); ++di) {
+    dials[di].value = values[di];
+  }
+  weights = std::move(new_weights);
+}
+
+} // namespace nuis
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "nuis/weightcalc/IWeightCalc.h"
+
+#include "nuis/eventinput/INormalizedEventSource.h"
+
+#include "nuis/response/FramedResponse.h"
+
+#include "nuis/except.h"
+
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nuis {
+
+NEW_NUISANCE_EXCEPT(InvalidSplineDial);
+NEW_NUISANCE_EXCEPT(SplineWeightCalcUnknownEvent);
+NEW_NUISANCE_EXCEPT(SplineWeightCalcDuplicateEvent);
+
+// Approximates another weight calculator with one natural cubic spline per
+// event per dial, so that changing the parameters no longer requires the
+// underlying reweighting engine.
+//
+// On construction, the events of evs are read once, in batches, and wc is
+// evaluated for every event at the nominal parameters and at each knot of each
+// dial, with all of the other dials held at their nominal values. The ratio to
+// the nominal weight is splined in each dial, and the spline coefficients of
+// all events are kept in one NaturalCubicFrameSpline per dial. Responses to
+// different dials are assumed to factorize, the weight at a parameter point is
+// the nominal weight times the product of the per-dial ratios.
+//
+// set_parameters evaluates the splines of every event at once, calc_weight then
+// only looks up the weight of the event with a matching event number, so the
+// event numbers of evs must be unique, e.g. not repeated across chained or
+// sharded inputs. Construction throws SplineWeightCalcDuplicateEvent if they
+// are not. Like the reweighting engines that it replaces, dials that are not
+// passed to set_parameters keep their previous values. Dials must be evaluated
+// within their knot range.
+class SplineWeightCalc : public IWeightCalcHM3Map {
+public:
+  using DialKnots = std::map<std::string, std::vector<double>>;
+
+  // Each dial needs at least 3 knots, one of which must be at its nominal
+  // value. Dials without a nominal value in nominal_parameters are nominally 0.
+  SplineWeightCalc(IWeightCalcHM3MapPtr wc, INormalizedEventSourcePtr evs,
+                   DialKnots const &dial_knots,
+                   ParamType const &nominal_parameters = {},
+                   size_t max_events = std::numeric_limits<size_t>::max(),
+                   size_t batch_size = 10000);
+
+  double calc_weight(HepMC3::GenEvent const &ev);
+  void set_parameters(ParamType const &params);
+
+  // the number of splined events
+  size_t size() const { return size_t(nominal_weights.size()); }
+
+private:
+  struct SplinedDial {
+    std::string name;
+    double nominal;
+    double value;
+    NaturalCubicFrameSplineXf spline;
+  };
+  std::vector<SplinedDial> dials;
+
+  std::unordered_map<int, size_t> event_rows;
+  Eigen::ArrayXd nominal_weights;
+  Eigen::ArrayXd weights;
+};
+
+} // namespace nuis
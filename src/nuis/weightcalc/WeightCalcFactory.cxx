@@ -1,4 +1,5 @@
 #include "nuis/eventinput/IEventSourceWrapper.h"
+#include "nuis/eventinput/PrefetchingEventSource.h"
 
 #include "nuis/weightcalc/WeightCalcFactory.h"
 
@@ -12,6 +13,7 @@
 NEW_NUISANCE_EXCEPT(NUISANCE_ROOTUndefined);
 NEW_NUISANCE_EXCEPT(UnableToProvisionWeightCalcPlugin);
 NEW_NUISANCE_EXCEPT(InvalidWeightCalcPluginRequested);
+NEW_NUISANCE_EXCEPT(WeightCalcWithPrefetchingEventSource);
 
 namespace nuis {
 WeightCalcFactory::WeightCalcFactory() {
@@ -43,6 +45,18 @@ IWeightCalcHM3MapPtr WeightCalcFactory::make(IEventSourcePtr evs,
     return nullptr;
   }
 
+  if (std::dynamic_pointer_cast<PrefetchingEventSource>(evs)) {
+    log_critical("Cannot provision a weightcalc plugin for a "
+                 "PrefetchingEventSource.");
+    throw WeightCalcWithPrefetchingEventSource();
+  }
+
+  // e.g. a shard of an input, plugins need the underlying source
+  auto wrapper = std::dynamic_pointer_cast<IEventSourceWrapper>(evs);
+  if (wrapper) {
+    return make(wrapper, cfg);
+  }
+
   if (cfg["plugin_name"]) {
     std::string plugin_name = cfg["plugin_name"].as<std::string>();
     for (auto &[pluginso, plugin] : pluginfactories) {
@@ -81,6 +95,14 @@ IWeightCalcHM3MapPtr WeightCalcFactory::make(IEventSourcePtr evs,
 
 IWeightCalcHM3MapPtr WeightCalcFactory::make(IWrappedEventSourcePtr evs,
                                              YAML::Node const &cfg) {
+  // weight calculators read from the underlying source, e.g. with
+  // TChain::GetEntry, which would race with the prefetcher's reader thread
+  if (evs->wraps<PrefetchingEventSource>()) {
+    log_critical("Cannot provision a weightcalc plugin for an event source "
+                 "that is prefetched on a background thread, remove the "
+                 "prefetch key from the input configuration.");
+    throw WeightCalcWithPrefetchingEventSource();
+  }
   return make(evs->unwrap(), cfg);
 }
 } // namespace nuis
\ No newline at end of file
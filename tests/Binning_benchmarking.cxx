@@ -1,6 +1,7 @@
 #include "catch2/benchmark/catch_benchmark.hpp"
 #include "catch2/catch_test_macros.hpp"
 
+#include "nuis/binning/BinExtentsIndex.h"
 #include "nuis/binning/Binning.h"
 #include "nuis/binning/exceptions.h"
 #include "nuis/binning/utility.h"
@@ -8,6 +9,8 @@
 
 #include "TAxis.h"
 
+#include "fmt/core.h"
+
 #include <cassert>
 #include <random>
 
@@ -104,6 +107,29 @@ TEST_CASE("lin_space", "[Binning]") {
     }
     return bin;
   };
+
+  Eigen::ArrayXXd rvals3d(ntest, 3);
+  rvals3d.col(0) = Eigen::Map<Eigen::ArrayXd>(rvalsx.data(), ntest);
+  rvals3d.col(1) = Eigen::Map<Eigen::ArrayXd>(rvalsy.data(), ntest);
+  rvals3d.col(2) = Eigen::Map<Eigen::ArrayXd>(rvalsz.data(), ntest);
+
+  BENCHMARK("[nuis] lin_space:1D find_bins, n = 1E6") {
+    return lin_bins->find_bins(rvals3d.leftCols(1));
+  };
+
+  BENCHMARK("[nuis] lin_spaceND:3D find_bins, n = 1E6") {
+    return lin_bins3d->find_bins(rvals3d);
+  };
+
+  BENCHMARK("[nuis] product(lin):3D find_bins, n = 1E6") {
+    return prod_lin_bins3d->find_bins(rvals3d);
+  };
+
+  auto batch_bins3d = lin_bins3d->find_bins(rvals3d);
+  for (size_t i = 0; i < std::min(ntest, 1000ul); ++i) {
+    REQUIRE(batch_bins3d[i] ==
+            lin_bins3d->find_bin({rvalsx[i], rvalsy[i], rvalsz[i]}));
+  }
 }
 
 TEST_CASE("contiguous", "[Binning]") {
@@ -142,6 +168,11 @@ TEST_CASE("contiguous", "[Binning]") {
     return bin;
   };
 
+  BENCHMARK("[nuis] contiguous:1D find_bins, n = 1E6") {
+    return lin_bins->find_bins(
+        Eigen::Map<Eigen::ArrayXXd>(rvals.data(), ntest, 1));
+  };
+
   for (size_t i = 0; i < std::min(ntest, 1000ul); ++i) {
     REQUIRE(int(lin_bins->find_bin(rvals[i]) + 1) == rootx->FindBin(rvals[i]));
   }
@@ -210,4 +241,76 @@ TEST_CASE("from_extents", "[Binning]") {
     }
     return bin;
   };
-}
\ No newline at end of file
+  for (size_t i = 0; i < std::min(ntest, 1000ul); ++i) {
+    REQUIRE(lin_bins3D->find_bin({rvalsx[i], rvalsy[i], rvalsz[i]}) ==
+            lin_bins3Dbf->find_bin({rvalsx[i], rvalsy[i], rvalsz[i]}));
+  }
+}
+
+TEST_CASE("from_extents irregular", "[Binning]") {
+  // every y slice has its own x binning, like a typical double differential
+  // cross-section measurement
+  std::vector<nuis::Binning::BinExtents> bins;
+  for (size_t yi = 0; yi < 40; ++yi) {
+    auto x_edges = nuis::lin_spaced_edges(-10, 10, 5 + (yi * 7) % 20);
+    for (auto const &x_ext : nuis::edges_to_extents(x_edges)) {
+      bins.push_back({x_ext[0], {-10 + yi * 0.5, -10 + (yi + 1) * 0.5}});
+    }
+  }
+
+  auto index_bins = nuis::Binning::from_extents(bins);
+  auto bf_bins = nuis::Binning::brute_force(bins);
+  nuis::BinExtentsIndex slab_index(bins, 1);
+
+  std::random_device r;
+
+  std::default_random_engine e1(r());
+  std::uniform_real_distribution<> uni(-10, 10);
+
+  size_t ntest = 1E5;
+
+  Eigen::ArrayXXd rvals(ntest, 2);
+  for (size_t i = 0; i < ntest; ++i) {
+    rvals(i, 0) = uni(e1);
+    rvals(i, 1) = uni(e1);
+  }
+
+  BENCHMARK(fmt::format("[nuis] from_extents:2D {} bins, n = 1E5",
+                        bins.size())) {
+    int bin = 0;
+    for (size_t i = 0; i < ntest; ++i) {
+      bin = index_bins->find_bin({rvals(i, 0), rvals(i, 1)});
+    }
+    return bin;
+  };
+
+  BENCHMARK(fmt::format("[nuis] from_extents:2D {} bins find_bins, n = 1E5",
+                        bins.size())) {
+    return index_bins->find_bins(rvals);
+  };
+
+  BENCHMARK(fmt::format("[nuis] slab lists:2D {} bins, n = 1E5",
+                        bins.size())) {
+    int bin = 0;
+    for (size_t i = 0; i < ntest; ++i) {
+      bin = slab_index({rvals(i, 0), rvals(i, 1)});
+    }
+    return bin;
+  };
+
+  BENCHMARK(fmt::format("[nuis] brute_force:2D {} bins, n = 1E5",
+                        bins.size())) {
+    int bin = 0;
+    for (size_t i = 0; i < ntest; ++i) {
+      bin = bf_bins->find_bin({rvals(i, 0), rvals(i, 1)});
+    }
+    return bin;
+  };
+
+  for (size_t i = 0; i < std::min(ntest, 1000ul); ++i) {
+    REQUIRE(index_bins->find_bin({rvals(i, 0), rvals(i, 1)}) ==
+            bf_bins->find_bin({rvals(i, 0), rvals(i, 1)}));
+    REQUIRE(slab_index({rvals(i, 0), rvals(i, 1)}) ==
+            bf_bins->find_bin({rvals(i, 0), rvals(i, 1)}));
+  }
+}
@@ -1,6 +1,7 @@
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/matchers/catch_matchers_floating_point.hpp"
 
+#include "nuis/binning/BinExtentsIndex.h"
 #include "nuis/binning/Binning.h"
 #include "nuis/binning/exceptions.h"
 #include "nuis/log.txx"
@@ -757,3 +758,150 @@ TEST_CASE("product::func", "[Binning]") {
   REQUIRE(ls->find_bin({0, 2.9, 6}) == nuis::Binning::npos);
   REQUIRE(ls->find_bin({0, 3, 5.9}) == nuis::Binning::npos);
 }
+
+// find_bins must agree with find_bin row-by-row, including for out of range
+// entries and entries that sit exactly on bin edges
+void require_find_bins_matches_find_bin(nuis::BinningPtr const &bins,
+                                        Eigen::ArrayXXd const &x) {
+  auto batch = bins->find_bins(x);
+  REQUIRE(batch.size() == x.rows());
+  for (Eigen::Index i = 0; i < x.rows(); ++i) {
+    std::vector<double> row(x.cols());
+    for (Eigen::Index j = 0; j < x.cols(); ++j) {
+      row[j] = x(i, j);
+    }
+    REQUIRE(batch[i] == bins->find_bin(row));
+  }
+}
+
+Eigen::ArrayXXd find_bins_test_points(size_t nax, double low, double high) {
+  size_t nrand = 200;
+  Eigen::ArrayXXd x = Eigen::ArrayXXd::Random(nrand + 5, nax);
+  x = low + (x + 1) * 0.6 * (high - low);
+  x.row(nrand).setConstant(low);
+  x.row(nrand + 1).setConstant(high);
+  x.row(nrand + 2).setConstant(low + (high - low) / 3.0);
+  // stay positive for logarithmic binnings
+  x.row(nrand + 3).setConstant((low > 0) ? (low / 2) : (low - 1));
+  x.row(nrand + 4).setConstant((low > 0) ? (high * 2) : 0);
+  return x;
+}
+
+TEST_CASE("find_bins::lin_space", "[Binning]") {
+  require_find_bins_matches_find_bin(nuis::Binning::lin_space(-10, 10, 30),
+                                     find_bins_test_points(1, -10, 10));
+}
+
+TEST_CASE("find_bins::lin_spaceND", "[Binning]") {
+  require_find_bins_matches_find_bin(
+      nuis::Binning::lin_spaceND({{-10, 10, 30}, {0, 5, 7}, {1, 2, 3}}),
+      find_bins_test_points(3, -10, 10));
+}
+
+TEST_CASE("find_bins::log10_space", "[Binning]") {
+  require_find_bins_matches_find_bin(nuis::Binning::log10_space(1E-2, 1E3, 25),
+                                     find_bins_test_points(1, 1E-2, 1E3));
+  require_find_bins_matches_find_bin(nuis::Binning::ln_space(0.5, 20, 13),
+                                     find_bins_test_points(1, 0.5, 20));
+}
+
+TEST_CASE("find_bins::contiguous", "[Binning]") {
+  require_find_bins_matches_find_bin(
+      nuis::Binning::contiguous({-3, -1, 0, 0.5, 2, 7}),
+      find_bins_test_points(1, -3, 7));
+
+  std::vector<double> many_edges = {0};
+  for (int i = 0; i < 100; ++i) {
+    many_edges.push_back(many_edges.back() + 0.1 + (i % 3));
+  }
+  require_find_bins_matches_find_bin(
+      nuis::Binning::contiguous(many_edges),
+      find_bins_test_points(1, 0, many_edges.back()));
+}
+
+TEST_CASE("find_bins::product", "[Binning]") {
+  require_find_bins_matches_find_bin(
+      nuis::Binning::product({nuis::Binning::lin_space(-10, 10, 30),
+                              nuis::Binning::contiguous({-3, -1, 0, 5})}),
+      find_bins_test_points(2, -5, 5));
+}
+
+TEST_CASE("find_bins::from_extents", "[Binning]") {
+  require_find_bins_matches_find_bin(
+      nuis::Binning::from_extents(
+          nuis::Binning::lin_spaceND({{-10, 10, 5}, {0, 5, 3}})->bins),
+      find_bins_test_points(2, -10, 10));
+}
+
+// A 2D binning where every y slice has its own x edges, or a 3D binning of
+// such slices, like many published double-differential measurements.
+std::vector<nuis::Binning::BinExtents> irregular_extents(size_t nax) {
+  std::vector<nuis::Binning::BinExtents> bins;
+  for (size_t zi = 0; zi < ((nax == 3) ? 4 : 1); ++zi) {
+    for (size_t yi = 0; yi < 7; ++yi) {
+      double x = -1;
+      for (size_t xi = 0; xi < (3 + (yi * 5 + zi) % 6); ++xi) {
+        double next_x = x + 0.3 + 0.2 * ((xi + yi + zi) % 4);
+        bins.push_back({{x, next_x}, {yi * 0.5, (yi + 1) * 0.5}});
+        if (nax == 3) {
+          bins.back().push_back({zi * 1.0, zi + 0.5 + 0.5 * (yi % 2)});
+        }
+        x = next_x;
+      }
+    }
+  }
+  return bins;
+}
+
+Eigen::ArrayXXd irregular_test_points(size_t nax) {
+  Eigen::ArrayXXd x = Eigen::ArrayXXd::Random(1000, nax) * 2 + 1.5;
+  // exactly on some of the edges
+  x.topRows(10).col(0).setConstant(-1);
+  x.topRows(10).col(1) = Eigen::ArrayXd::LinSpaced(10, 0, 4.5);
+  return x;
+}
+
+void require_matches_brute_force(
+    std::function<nuis::Binning::index_t(std::vector<double> const &)> const
+        &find_bin,
+    std::vector<nuis::Binning::BinExtents> const &bins,
+    Eigen::ArrayXXd const &x) {
+  auto bf = nuis::Binning::brute_force(bins);
+  for (Eigen::Index i = 0; i < x.rows(); ++i) {
+    std::vector<double> row(x.cols());
+    for (Eigen::Index j = 0; j < x.cols(); ++j) {
+      row[j] = x(i, j);
+    }
+    REQUIRE(find_bin(row) == bf->find_bin(row));
+  }
+}
+
+TEST_CASE("from_extents::func -- irregular", "[Binning]") {
+  for (size_t nax : {2, 3}) {
+    auto bins = irregular_extents(nax);
+    auto x = irregular_test_points(nax);
+
+    auto ls = nuis::Binning::from_extents(bins);
+    require_matches_brute_force(ls->binning_function, bins, x);
+    require_find_bins_matches_find_bin(ls, x);
+
+    // force the slab lists fallback
+    nuis::BinExtentsIndex slab_index(bins, 1);
+    REQUIRE(!slab_index.is_grid());
+    require_matches_brute_force(slab_index, bins, x);
+  }
+}
+
+TEST_CASE("BinExtentsIndex::overlaps", "[Binning]") {
+  std::vector<nuis::Binning::BinExtents> bins = {
+      {{0, 2}, {0, 2}}, {{1, 3}, {1, 3}}, {{-1, 4}, {-1, 4}}};
+
+  for (size_t max_cells : {nuis::BinExtentsIndex::default_max_cells, 1ul}) {
+    nuis::BinExtentsIndex index(bins, max_cells);
+    REQUIRE(index({1.5, 1.5}) == 0);
+    REQUIRE(index({2.5, 2.5}) == 1);
+    REQUIRE(index({3.5, -0.5}) == 2);
+    REQUIRE(index({4, 0}) == nuis::Binning::npos);
+    REQUIRE(index({std::nan(""), 0}) == nuis::Binning::npos);
+  }
+}
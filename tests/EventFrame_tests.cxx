@@ -2,8 +2,19 @@
 #include "catch2/matchers/catch_matchers_floating_point.hpp"
 
 #include "nuis/eventframe/EventFrame.h"
+#include "nuis/eventframe/EventFrameCache.h"
+#include "nuis/eventframe/EventFrameGen.h"
+
+#include "StubEventSource.h"
 
 #include <cassert>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 TEST_CASE("EventFrame::find_column_index", "[EventFrame]") {
   nuis::EventFrame f;
@@ -72,3 +83,355 @@ TEST_CASE("Set Eigen::Ref from EventFrame::cols(strings)", "[EventFrame]") {
   REQUIRE(f.cols({"b"})[0][1] == -123);
   REQUIRE(f.cols({"c"})[0][1] == -123);
 }
+
+TEST_CASE("NormInfo merge", "[EventFrame]") {
+  // fixed fatx
+  nuis::NormInfo a{2.5, 10, 10}, b{2.5, 30, 30}, empty{0, 0, 0};
+  auto ab = a + b;
+  REQUIRE_THAT(ab.fatx, Catch::Matchers::WithinULP(2.5, 1));
+  REQUIRE(ab.sumweights == 40);
+  REQUIRE(ab.nevents == 40);
+  REQUIRE_THAT((a + empty).fatx, Catch::Matchers::WithinULP(2.5, 1));
+  REQUIRE_THAT((empty + a).fatx, Catch::Matchers::WithinULP(2.5, 1));
+
+  // fatx estimated from per-event cross sections, sumw / sum(w/xs)
+  std::vector<double> xs{1, 2, 3, 4, 5, 6}, w{1, 2, 1, 1, 3, 1};
+  auto estimate = [&](size_t begin, size_t end) {
+    double sumw = 0, sumwoxs = 0;
+    for (size_t i = begin; i < end; ++i) {
+      sumw += w[i];
+      sumwoxs += w[i] / xs[i];
+    }
+    return nuis::NormInfo{sumw / sumwoxs, sumw, end - begin};
+  };
+
+  auto serial = estimate(0, 6);
+  auto merged = merge(estimate(0, 1), merge(estimate(1, 4), estimate(4, 6)));
+  REQUIRE_THAT(merged.fatx, Catch::Matchers::WithinRel(serial.fatx, 1E-12));
+  REQUIRE(merged.sumweights == serial.sumweights);
+  REQUIRE(merged.nevents == serial.nevents);
+
+  auto merged_other = merge(merge(estimate(0, 1), estimate(1, 4)), estimate(4, 6));
+  REQUIRE_THAT(merged_other.fatx, Catch::Matchers::WithinRel(merged.fatx, 1E-12));
+}
+
+TEST_CASE("EventFrame::index_columns", "[EventFrame]") {
+  nuis::EventFrame f;
+  f.column_names = {"a", "b", "c"};
+  f.table = Eigen::ArrayXXd::Zero(0, 3);
+  f.index_columns();
+
+  REQUIRE(f.find_column_index("a") == 0);
+  REQUIRE(f.find_column_index("c") == 2);
+  REQUIRE(f.find_column_index("d") == nuis::EventFrame::npos);
+
+  // a stale index must not return the wrong column
+  f.column_names = {"c", "b", "a", "d"};
+  REQUIRE(f.find_column_index("a") == 2);
+  REQUIRE(f.find_column_index("b") == 1);
+  REQUIRE(f.find_column_index("d") == 3);
+}
+
+TEST_CASE("EventFrame::span", "[EventFrame]") {
+  nuis::EventFrame f;
+  f.column_names = {"a", "b"};
+  f.table = Eigen::ArrayXXd::Zero(3, 2);
+  f.table.col(1) = Eigen::ArrayXd::Constant(3, 222);
+
+  auto h = f.column_handle("b");
+  REQUIRE_THROWS_AS(f.column_handle("c"), nuis::InvalidFrameColumnName);
+  REQUIRE_THROWS_AS(f.span<float>(h), nuis::InvalidFrameColumnType);
+
+  auto b = f.span<double>(h);
+  REQUIRE(b.size() == 3);
+  REQUIRE(b[2] == 222);
+  b[0] = -123;
+  REQUIRE(f.table(0, 1) == -123);
+
+  Eigen::ArrayXd scratch;
+  REQUIRE(f.span_as_double(h, scratch).data() == f.table.col(1).data());
+
+  f.column_locations = {{nuis::column_type<double>::id, 0},
+                        {nuis::column_type<int>::id, 0}};
+  f.int_table = Eigen::ArrayXXi::Constant(3, 1, 7);
+  f.int_table(1, 0) = nuis::kMissingDatum<int>;
+  auto wide = f.span_as_double(f.column_handle("b"), scratch);
+  REQUIRE(wide[0] == 7);
+  REQUIRE(wide[1] == nuis::kMissingDatum<double>);
+}
+
+namespace {
+struct TempDir {
+  std::filesystem::path path;
+  TempDir() {
+    path = std::filesystem::temp_directory_path() /
+           ("nuis-EventFrame_tests-" + std::to_string(::getpid()));
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+  }
+  ~TempDir() { std::filesystem::remove_all(path); }
+
+  size_t num_files() const {
+    return std::distance(std::filesystem::directory_iterator(path),
+                         std::filesystem::directory_iterator());
+  }
+};
+
+std::vector<std::string> const cache_column_names = {"a", "b", "c"};
+std::vector<int> const cache_column_types = {nuis::column_type<double>::id,
+                                             nuis::column_type<int>::id,
+                                             nuis::column_type<float>::id};
+
+// row i has a = i, b = 10 * i, c = i / 4
+nuis::EventFrame typed_cache_frame(size_t first_row, size_t nrows) {
+  nuis::EventFrame f;
+  f.column_names = cache_column_names;
+  f.column_locations = {{nuis::column_type<double>::id, 0},
+                        {nuis::column_type<int>::id, 0},
+                        {nuis::column_type<float>::id, 0}};
+  f.table = Eigen::ArrayXXd(nrows, 1);
+  f.int_table = Eigen::ArrayXXi(nrows, 1);
+  f.float_table = Eigen::ArrayXXf(nrows, 1);
+  for (size_t i = 0; i < nrows; ++i) {
+    f.table(i, 0) = double(first_row + i);
+    f.int_table(i, 0) = int(10 * (first_row + i));
+    f.float_table(i, 0) = float(first_row + i) / 4.f;
+  }
+  f.num_rows = nrows;
+  return f;
+}
+
+nuis::EventFrame untyped_cache_frame(size_t first_row, size_t nrows) {
+  nuis::EventFrame f;
+  f.column_names = cache_column_names;
+  f.table = Eigen::ArrayXXd(nrows, 3);
+  for (size_t i = 0; i < nrows; ++i) {
+    f.table(i, 0) = double(first_row + i);
+    f.table(i, 1) = double(10 * (first_row + i));
+    f.table(i, 2) = double(first_row + i) / 4.;
+  }
+  f.num_rows = nrows;
+  return f;
+}
+
+// the normalization state after reading row i
+nuis::NormInfo cache_row_norm(size_t i) {
+  return {1.5 + double(i), 2. * double(i + 1), i + 1};
+}
+
+std::vector<nuis::NormInfo> cache_row_norms(size_t first_row, size_t nrows) {
+  std::vector<nuis::NormInfo> norms;
+  for (size_t i = 0; i < nrows; ++i) {
+    norms.push_back(cache_row_norm(first_row + i));
+  }
+  return norms;
+}
+} // namespace
+
+TEST_CASE("EventFrameCache round trip", "[EventFrame]") {
+  TempDir tmp;
+  auto path = tmp.path / "frame.cache";
+  uint64_t key = nuis::fnv1a64("EventFrameCache round trip");
+
+  {
+    nuis::EventFrameCacheWriter writer(path, key, cache_column_names,
+                                       cache_column_types);
+    writer.append(typed_cache_frame(0, 3), cache_row_norms(0, 3));
+    writer.append(typed_cache_frame(3, 0), cache_row_norms(3, 0));
+    writer.append(untyped_cache_frame(3, 4), cache_row_norms(3, 4));
+    writer.append(untyped_cache_frame(7, 0), cache_row_norms(7, 0));
+    writer.append(typed_cache_frame(7, 2), cache_row_norms(7, 2));
+    writer.finalize({3.5, 20, 10});
+  }
+  // only the cache itself is left behind
+  REQUIRE(tmp.num_files() == 1);
+
+  auto rdr = nuis::EventFrameCacheReader::open(path, key);
+  REQUIRE(rdr);
+  REQUIRE(rdr->num_rows() == 9);
+  REQUIRE(rdr->get_column_names() == cache_column_names);
+  REQUIRE(rdr->get_column_types() == cache_column_types);
+
+  for (size_t i = 0; i < rdr->num_rows(); ++i) {
+    REQUIRE(rdr->column(0)[i] == double(i));
+    REQUIRE(rdr->column(1)[i] == double(10 * i));
+    REQUIRE(rdr->column(2)[i] == double(i) / 4.);
+
+    auto norm = rdr->row_norm_info(i);
+    REQUIRE(norm.fatx == cache_row_norm(i).fatx);
+    REQUIRE(norm.sumweights == cache_row_norm(i).sumweights);
+    REQUIRE(norm.nevents == cache_row_norm(i).nevents);
+  }
+
+  REQUIRE(rdr->norm_info().fatx == 3.5);
+  REQUIRE(rdr->norm_info().sumweights == 20);
+  REQUIRE(rdr->norm_info().nevents == 10);
+}
+
+TEST_CASE("EventFrameCache empty", "[EventFrame]") {
+  TempDir tmp;
+  auto path = tmp.path / "empty.cache";
+  uint64_t key = nuis::fnv1a64("EventFrameCache empty");
+
+  {
+    nuis::EventFrameCacheWriter writer(path, key, cache_column_names,
+                                       cache_column_types);
+    writer.append(typed_cache_frame(0, 0), {});
+    writer.finalize({0, 0, 0});
+  }
+
+  auto rdr = nuis::EventFrameCacheReader::open(path, key);
+  REQUIRE(rdr);
+  REQUIRE(rdr->num_rows() == 0);
+  REQUIRE(rdr->get_column_names() == cache_column_names);
+  REQUIRE(rdr->get_column_types() == cache_column_types);
+  REQUIRE(rdr->norm_info().nevents == 0);
+}
+
+TEST_CASE("EventFrameCache rejects invalid files", "[EventFrame]") {
+  TempDir tmp;
+  auto path = tmp.path / "frame.cache";
+  uint64_t key = nuis::fnv1a64("EventFrameCache rejects invalid files");
+
+  REQUIRE(!nuis::EventFrameCacheReader::open(path, key));
+
+  {
+    nuis::EventFrameCacheWriter writer(path, key, cache_column_names,
+                                       cache_column_types);
+    writer.append(untyped_cache_frame(0, 100), cache_row_norms(0, 100));
+    writer.finalize(cache_row_norm(99));
+  }
+  REQUIRE(nuis::EventFrameCacheReader::open(path, key));
+
+  SECTION("wrong key") {
+    REQUIRE(!nuis::EventFrameCacheReader::open(path, key + 1));
+  }
+
+  SECTION("truncated data") {
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    REQUIRE(!nuis::EventFrameCacheReader::open(path, key));
+  }
+
+  SECTION("truncated header") {
+    std::filesystem::resize_file(path, 16);
+    REQUIRE(!nuis::EventFrameCacheReader::open(path, key));
+  }
+}
+
+TEST_CASE("EventFrameCache abandoned writer", "[EventFrame]") {
+  TempDir tmp;
+  auto path = tmp.path / "frame.cache";
+  uint64_t key = nuis::fnv1a64("EventFrameCache abandoned writer");
+
+  {
+    nuis::EventFrameCacheWriter writer(path, key, cache_column_names,
+                                       cache_column_types);
+    writer.append(typed_cache_frame(0, 3), cache_row_norms(0, 3));
+    // the temporary row file exists while the writer is live
+    REQUIRE(tmp.num_files() == 1);
+    REQUIRE(!std::filesystem::exists(path));
+  }
+
+  REQUIRE(tmp.num_files() == 0);
+  REQUIRE(!nuis::EventFrameCacheReader::open(path, key));
+}
+
+namespace {
+// every event but every fifth, with a double and an int column
+nuis::EventFrameGen stub_frame_gen(size_t nevents = 4500) {
+  auto evs = std::make_shared<nuis::INormalizedEventSource>(
+      std::make_shared<nuis::test::StubEventSource>(
+          nevents, std::vector<double>{1, 0.5, 2, 1.5}, 2.5));
+  return nuis::EventFrameGen(evs)
+      .filter([](HepMC3::GenEvent const &ev) {
+        return int(ev.event_number() % 5 != 0);
+      })
+      .add_column("enu",
+                  [](HepMC3::GenEvent const &ev) {
+                    for (auto const &part : ev.particles()) {
+                      if (part->pid() == 14) {
+                        return part->momentum().e();
+                      }
+                    }
+                    return nuis::kMissingDatum<double>;
+                  })
+      .add_typed_column<int>("nparts", [](HepMC3::GenEvent const &ev) {
+        return int(ev.particles().size());
+      });
+}
+
+void require_same_norm_info(nuis::NormInfo const &a, nuis::NormInfo const &b) {
+  REQUIRE(a.fatx == b.fatx);
+  REQUIRE(a.sumweights == b.sumweights);
+  REQUIRE(a.nevents == b.nevents);
+}
+
+void require_same_frame(nuis::EventFrame const &a, nuis::EventFrame const &b) {
+  REQUIRE(a.column_names == b.column_names);
+  REQUIRE(a.column_locations.size() == b.column_locations.size());
+  for (size_t i = 0; i < a.column_locations.size(); ++i) {
+    REQUIRE(a.column_locations[i].typenum == b.column_locations[i].typenum);
+    REQUIRE(a.column_locations[i].index == b.column_locations[i].index);
+  }
+  REQUIRE(a.num_rows == b.num_rows);
+  auto wa = a.widened();
+  auto wb = b.widened();
+  REQUIRE((wa.table.topRows(a.num_rows) == wb.table.topRows(b.num_rows)).all());
+  require_same_norm_info(a.norm_info, b.norm_info);
+}
+} // namespace
+
+TEST_CASE("EventFrameGen threads matches serial", "[EventFrame]") {
+  for (bool typed : {false, true}) {
+    // the whole source and a limit part way through a batch
+    for (size_t nmax : {std::numeric_limits<size_t>::max(), size_t(2650)}) {
+      auto serial_gen = stub_frame_gen().typed_storage(typed).limit(nmax);
+      auto serial = serial_gen.all();
+      REQUIRE(serial.num_rows == ((std::min(nmax, size_t(4500)) * 4) / 5));
+
+      auto threaded_gen =
+          stub_frame_gen().typed_storage(typed).limit(nmax).threads(4, 100);
+      auto threaded = threaded_gen.all();
+
+      require_same_frame(threaded, serial);
+      require_same_norm_info(threaded_gen.norm_info(), serial_gen.norm_info());
+    }
+  }
+}
+
+TEST_CASE("EventFrameGen threads matches serial chunks", "[EventFrame]") {
+  auto serial_gen = stub_frame_gen();
+  auto threaded_gen = stub_frame_gen().threads(4, 100);
+
+  auto serial = serial_gen.first(333);
+  auto threaded = threaded_gen.first(333);
+  size_t nrows = 0;
+  while (serial.num_rows) {
+    require_same_frame(threaded, serial);
+    require_same_norm_info(threaded_gen.norm_info(), serial_gen.norm_info());
+    nrows += serial.num_rows;
+
+    serial = serial_gen.next(333);
+    threaded = threaded_gen.next(333);
+  }
+  REQUIRE(threaded.num_rows == 0);
+  REQUIRE(nrows == 3600);
+  require_same_norm_info(threaded_gen.norm_info(), serial_gen.norm_info());
+}
+
+TEST_CASE("EventFrameGen cache with filters", "[EventFrame]") {
+  TempDir tmp;
+
+  // the key only counts the filters, so they must be named by projection_id
+  auto unnamed = stub_frame_gen().cache(tmp.path, {}, "");
+  REQUIRE_THROWS_AS(unnamed.first(),
+                    nuis::EventFrameGenCacheMissingProjectionId);
+
+  auto writer_gen = stub_frame_gen().cache(tmp.path, {}, "every-fifth-v1");
+  auto written = writer_gen.all();
+  REQUIRE(written.num_rows == 3600);
+
+  auto reader_gen = stub_frame_gen().cache(tmp.path, {}, "every-fifth-v1");
+  require_same_frame(reader_gen.all(), written);
+  require_same_norm_info(reader_gen.norm_info(), writer_gen.norm_info());
+}
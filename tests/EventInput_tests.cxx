@@ -0,0 +1,402 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "nuis/eventinput/EventParticleView.h"
+#include "nuis/eventinput/GenEventPool.h"
+#include "nuis/eventinput/HepMC3EventSource.h"
+#include "nuis/eventinput/PrefetchingEventSource.h"
+
+#include "StubEventSource.h"
+
+#include "HepMC3/WriterAscii.h"
+#include "HepMC3/WriterAsciiHepMC2.h"
+
+#include <cmath>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nuis;
+
+namespace {
+std::vector<int> read_event_numbers(IEventSource &evs, size_t nmax = 1000) {
+  std::vector<int> evnos;
+  for (auto ev = evs.first(); ev && (evnos.size() < nmax); ev = evs.next()) {
+    evnos.push_back(ev->event_number());
+  }
+  return evnos;
+}
+std::vector<int> iota(int n) {
+  std::vector<int> v;
+  for (int i = 0; i < n; ++i) {
+    v.push_back(i);
+  }
+  return v;
+}
+
+// Writes nevents stub events to a temporary file with a HepMC3 Writer, the
+// file is removed when this goes out of scope
+template <typename Writer> struct StubHepMC3File {
+  std::filesystem::path path;
+
+  StubHepMC3File(std::string const &name, size_t nevents)
+      : path(std::filesystem::temp_directory_path() /
+             ("nuis-EventInput_tests-" + std::to_string(::getpid()) + "-" +
+              name)) {
+    auto run_info = test::stub_run_info();
+    Writer wrtr(path.native(), run_info);
+    for (size_t i = 0; i < nevents; ++i) {
+      wrtr.write_event(*test::stub_event(run_info, int(i)));
+    }
+    wrtr.close();
+  }
+  StubHepMC3File(StubHepMC3File const &) = delete;
+
+  ~StubHepMC3File() { std::filesystem::remove(path); }
+};
+
+size_t const nhepmc3_events = 25;
+
+void check_seek(HepMC3EventSource &evs) {
+  REQUIRE(evs.num_entries() == nhepmc3_events);
+  for (size_t i : {7, 0, 24, 3, 12}) {
+    auto ev = evs.seek(i);
+    REQUIRE(ev);
+    REQUIRE(ev->event_number() == int(i));
+    // and reading continues from there
+    if ((i + 1) < nhepmc3_events) {
+      REQUIRE(evs.next()->event_number() == int(i + 1));
+    } else {
+      REQUIRE(!evs.next());
+    }
+  }
+  REQUIRE(!evs.seek(nhepmc3_events));
+}
+
+void check_shards(HepMC3EventSource &evs) {
+  auto serial = read_event_numbers(evs);
+  REQUIRE(serial == iota(nhepmc3_events));
+
+  std::vector<int> sharded;
+  for (auto [begin, end] : {std::pair<size_t, size_t>{0, 10},
+                            {10, 17},
+                            {17, 17},
+                            {17, nhepmc3_events}}) {
+    auto shard = evs.make_shard(begin, end);
+    auto evnos = read_event_numbers(*shard);
+    REQUIRE(evnos.size() == (end - begin));
+    sharded.insert(sharded.end(), evnos.begin(), evnos.end());
+
+    // shards seek relative to their first entry
+    auto ranged = std::dynamic_pointer_cast<IRangedEventSource>(shard);
+    REQUIRE(ranged);
+    REQUIRE(ranged->num_entries() == (end - begin));
+    if (end > begin) {
+      REQUIRE(ranged->seek(end - begin - 1)->event_number() == int(end - 1));
+    }
+    REQUIRE(!ranged->seek(end - begin));
+  }
+  REQUIRE(sharded == serial);
+}
+} // namespace
+
+TEST_CASE("PrefetchingEventSource order", "[EventInput]") {
+  for (size_t depth : {1, 4, 64, 1000}) {
+    PrefetchingEventSource evs(std::make_shared<test::StubEventSource>(100),
+                               depth);
+    REQUIRE(read_event_numbers(evs) == iota(100));
+  }
+}
+
+TEST_CASE("PrefetchingEventSource end of stream", "[EventInput]") {
+  PrefetchingEventSource empty(std::make_shared<test::StubEventSource>(0), 4);
+  REQUIRE(!empty.first());
+  REQUIRE(!empty.next());
+
+  PrefetchingEventSource evs(std::make_shared<test::StubEventSource>(3), 4);
+  REQUIRE(evs.first()->event_number() == 0);
+  REQUIRE(evs.next()->event_number() == 1);
+  REQUIRE(evs.next()->event_number() == 2);
+  REQUIRE(!evs.next());
+  REQUIRE(!evs.next());
+}
+
+TEST_CASE("PrefetchingEventSource first restarts", "[EventInput]") {
+  auto stub = std::make_shared<test::StubEventSource>(100);
+  PrefetchingEventSource evs(stub, 8);
+
+  REQUIRE(read_event_numbers(evs, 10) == iota(10));
+  REQUIRE(read_event_numbers(evs) == iota(100));
+  REQUIRE(read_event_numbers(evs) == iota(100));
+  REQUIRE(stub->nfirst == 3);
+}
+
+TEST_CASE("PrefetchingEventSource error propagation", "[EventInput]") {
+  PrefetchingEventSource evs(
+      std::make_shared<test::StubEventSource>(
+          100, std::vector<double>{}, 1, 50),
+      8);
+
+  std::vector<int> evnos;
+  auto ev = evs.first();
+  REQUIRE_THROWS_AS(
+      [&]() {
+        for (; ev; ev = evs.next()) {
+          evnos.push_back(ev->event_number());
+        }
+      }(),
+      test::StubEventSourceError);
+  REQUIRE(evnos == iota(50));
+  // the error is only raised once, after which the stream has ended
+  REQUIRE(!evs.next());
+
+  // and the source can be restarted
+  REQUIRE(evs.first()->event_number() == 0);
+}
+
+TEST_CASE("EventParticleView contents", "[EventInput]") {
+  auto run_info = test::stub_run_info();
+  // two final state pi+
+  auto ev = test::stub_event(run_info, 2);
+  EventParticleView view(*ev);
+
+  REQUIRE(&view.event() == ev.get());
+  REQUIRE(view.beam());
+  REQUIRE(view.beam()->pid() == 14);
+  REQUIRE(view.beam()->momentum().e() == 300);
+  REQUIRE(view.target());
+  REQUIRE(view.target()->pid() == 1000060120);
+
+  REQUIRE(view.final_state().size() == 3);
+  REQUIRE(view.final_state(13).size() == 1);
+  REQUIRE(view.final_state(2212).empty());
+  REQUIRE(!view.highest_momentum(2212));
+
+  auto const &pips = view.final_state(211);
+  REQUIRE(pips.size() == 2);
+  REQUIRE(pips[0]->momentum().p3mod() > pips[1]->momentum().p3mod());
+  REQUIRE(view.highest_momentum(211) == pips[0]);
+
+  // memoized, the same containers are returned for every query
+  REQUIRE(&view.final_state(211) == &pips);
+}
+
+TEST_CASE("EventParticleView momentum ordering", "[EventInput]") {
+  auto ev = test::stub_event(test::stub_run_info(), 0);
+  auto vtx = ev->vertices().front();
+  // added out of momentum order
+  for (double p : {50., 300., 10., 200.}) {
+    vtx->add_particle_out(std::make_shared<HepMC3::GenParticle>(
+        HepMC3::FourVector{0, p, 0, std::sqrt(p * p + 938.27 * 938.27)}, 2212,
+        NuHepMC::ParticleStatus::UndecayedPhysical));
+  }
+
+  EventParticleView view(*ev);
+  std::vector<double> ps;
+  for (auto const &part : view.final_state(2212)) {
+    ps.push_back(part->momentum().p3mod());
+  }
+  REQUIRE(ps == std::vector<double>{300, 200, 50, 10});
+}
+
+TEST_CASE("EventParticleView::current", "[EventInput]") {
+  auto run_info = test::stub_run_info();
+  auto ev1 = test::stub_event(run_info, 1);
+  auto ev2 = test::stub_event(run_info, 2);
+
+  REQUIRE_THROWS_AS(EventParticleView::current(*ev1), NoEventParticleViewScope);
+
+  {
+    EventParticleView::Scope s1(*ev1);
+    auto const &v1 = EventParticleView::current(*ev1);
+    REQUIRE(&v1 == &s1.get());
+    REQUIRE(&v1.event() == ev1.get());
+    REQUIRE_THROWS_AS(EventParticleView::current(*ev2),
+                      NoEventParticleViewScope);
+
+    {
+      // a nested scope for the same event shares the enclosing view
+      EventParticleView::Scope s1_inner(*ev1);
+      REQUIRE(&s1_inner.get() == &v1);
+      REQUIRE(&EventParticleView::current(*ev1) == &v1);
+    }
+    REQUIRE(&EventParticleView::current(*ev1) == &v1);
+
+    {
+      // a nested scope for another event shadows the enclosing one
+      EventParticleView::Scope s2(*ev2);
+      REQUIRE(&s2.get() != &v1);
+      REQUIRE(&EventParticleView::current(*ev2) == &s2.get());
+      REQUIRE(EventParticleView::current(*ev2).beam()->momentum().e() == 300);
+      REQUIRE_THROWS_AS(EventParticleView::current(*ev1),
+                        NoEventParticleViewScope);
+    }
+
+    // and is restored when it closes
+    REQUIRE(&EventParticleView::current(*ev1) == &v1);
+    REQUIRE(v1.beam()->momentum().e() == 200);
+  }
+
+  REQUIRE_THROWS_AS(EventParticleView::current(*ev1), NoEventParticleViewScope);
+}
+
+TEST_CASE("EventParticleView::memoized", "[EventInput]") {
+  auto key_a = EventParticleView::memo_key("test:a");
+  auto key_b = EventParticleView::memo_key("test:b");
+  REQUIRE(key_a != key_b);
+  REQUIRE(EventParticleView::memo_key("test:a") == key_a);
+
+  auto run_info = test::stub_run_info();
+  auto ev1 = test::stub_event(run_info, 1);
+  auto ev2 = test::stub_event(run_info, 2);
+
+  int ncalls = 0;
+  auto enu = [&](HepMC3::GenEvent const &ev) {
+    ncalls++;
+    return EventParticleView::current(ev).beam()->momentum().e();
+  };
+
+  {
+    EventParticleView::Scope s1(*ev1);
+    auto const &v1 = s1.get();
+    REQUIRE(v1.memoized(key_a, [&]() { return enu(*ev1); }) == 200);
+    REQUIRE(v1.memoized(key_a, [&]() { return enu(*ev1); }) == 200);
+    REQUIRE(ncalls == 1);
+    REQUIRE(v1.memoized(key_b, [&]() { return 2 * enu(*ev1); }) == 400);
+    REQUIRE(ncalls == 2);
+  }
+  {
+    EventParticleView::Scope s2(*ev2);
+    REQUIRE(s2.get().memoized(key_a, [&]() { return enu(*ev2); }) == 300);
+    REQUIRE(ncalls == 3);
+  }
+}
+
+TEST_CASE("HepMC3EventSource seek and shards", "[EventInput]") {
+  StubHepMC3File<HepMC3::WriterAscii> f("seek.hepmc3", nhepmc3_events);
+  HepMC3EventSource evs(f.path);
+
+  SECTION("seek") { check_seek(evs); }
+  SECTION("shards") { check_shards(evs); }
+}
+
+TEST_CASE("HepMC3EventSource seek and shards without an index",
+          "[EventInput]") {
+  // not Asciiv3, so events are read to count and seek
+  StubHepMC3File<HepMC3::WriterAsciiHepMC2> f("seek.hepmc2",
+                                               nhepmc3_events);
+  HepMC3EventSource evs(f.path);
+
+  SECTION("seek") { check_seek(evs); }
+  SECTION("shards") { check_shards(evs); }
+
+  SECTION("counting does not move the reader") {
+    REQUIRE(evs.first()->event_number() == 0);
+    REQUIRE(evs.next()->event_number() == 1);
+    REQUIRE(evs.num_entries() == nhepmc3_events);
+    REQUIRE(evs.next()->event_number() == 2);
+  }
+}
+
+TEST_CASE("GenEventPool reuse", "[EventInput]") {
+  GenEventPool pool(2);
+  REQUIRE(pool.size() == 2);
+
+  auto ev = pool.get();
+  auto evp = ev.get();
+  auto run_info = test::stub_run_info();
+  ev->set_run_info(run_info);
+  ev->add_vertex(std::make_shared<HepMC3::GenVertex>());
+  ev.reset();
+
+  // the released event is handed out again, cleared
+  ev = pool.get();
+  REQUIRE(ev.get() == evp);
+  REQUIRE(ev->vertices().empty());
+  REQUIRE(!ev->run_info());
+}
+
+TEST_CASE("GenEventPool still referenced", "[EventInput]") {
+  GenEventPool pool(2);
+
+  auto a = pool.get();
+  auto b = pool.get();
+  REQUIRE(a != b);
+
+  // the pool is full and both events are in use, so a new event is allocated
+  auto c = pool.get();
+  REQUIRE(c != a);
+  REQUIRE(c != b);
+
+  // any other shared pointer to an event keeps it in use
+  auto a_copy = a;
+  auto b_copy = b;
+  auto ap = a.get(), bp = b.get();
+  a.reset();
+  b.reset();
+  auto d = pool.get();
+  REQUIRE(d.get() != ap);
+  REQUIRE(d.get() != bp);
+
+  a_copy.reset();
+  REQUIRE(pool.get().get() == ap);
+}
+
+TEST_CASE("GenEventPool release on other threads", "[EventInput]") {
+  GenEventPool pool(4);
+
+  std::set<HepMC3::GenEvent *> pooled;
+  std::vector<std::thread> releasers;
+  for (int round = 0; round < 200; ++round) {
+    std::vector<std::shared_ptr<HepMC3::GenEvent>> evs;
+    for (int i = 0; i < 4; ++i) {
+      evs.push_back(pool.get());
+      REQUIRE(evs.back()->vertices().empty());
+      evs.back()->set_event_number(round);
+      if (round == 0) {
+        pooled.insert(evs.back().get());
+      }
+    }
+    // the last references are dropped on another thread, while this one keeps
+    // getting events from the pool
+    releasers.emplace_back([evs = std::move(evs)]() mutable {
+      for (auto &ev : evs) {
+        ev->add_vertex(std::make_shared<HepMC3::GenVertex>());
+        ev.reset();
+      }
+    });
+  }
+  for (auto &r : releasers) {
+    r.join();
+  }
+
+  // every pooled event has been returned
+  std::vector<std::shared_ptr<HepMC3::GenEvent>> evs;
+  for (int i = 0; i < 4; ++i) {
+    evs.push_back(pool.get());
+    REQUIRE(pooled.count(evs.back().get()));
+  }
+}
+
+TEST_CASE("GenEventPool events outlive the pool", "[EventInput]") {
+  std::shared_ptr<HepMC3::GenEvent> ev;
+  {
+    GenEventPool pool(1);
+    ev = pool.get();
+  }
+  ev->set_event_number(1);
+  ev.reset();
+}
+
+TEST_CASE("GenEventPool disabled", "[EventInput]") {
+  GenEventPool pool;
+  REQUIRE(pool.size() == 0);
+
+  auto a = pool.get();
+  auto b = pool.get();
+  REQUIRE(b != a);
+}
@@ -0,0 +1,60 @@
+#include "catch2/benchmark/catch_benchmark.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include "nuis/histframe/HistFrame.h"
+#include "nuis/histframe/fill_from_EventFrame.h"
+#include "nuis/log.txx"
+
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <random>
+
+TEST_CASE("fill_procid_columns_from_EventFrame", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(-10, 10, 100);
+
+  std::random_device r;
+
+  std::default_random_engine e1(r());
+  std::uniform_real_distribution<> uni(-10, 10);
+  std::uniform_int_distribution<> procids(0, 99);
+
+  size_t ntest = 1E7;
+
+  nuis::EventFrame ef;
+  ef.column_names = {"x", "process.id", "weight.cv"};
+  ef.table = Eigen::ArrayXXd::Zero(ntest, 3);
+  for (size_t i = 0; i < ntest; ++i) {
+    ef.table(i, 0) = uni(e1);
+    ef.table(i, 1) = procids(e1);
+    ef.table(i, 2) = 1 + uni(e1) / 20.0;
+  }
+
+  // the per-row fill that fill_procid_columns_from_EventFrame used to do
+  BENCHMARK("[row] 100 procid columns, n = 1E7") {
+    nuis::HistFrame hf(bins);
+    std::vector<int> proc_id_dictionary;
+    for (size_t i = 0; i < ntest; ++i) {
+      auto bin = hf.find_bin(std::vector<double>{ef.table(i, 0)});
+      double weight = ef.table(i, 2);
+      hf.fill_bin(bin, weight, 0);
+
+      int colv = ef.table(i, 1);
+      auto it =
+          std::find(proc_id_dictionary.begin(), proc_id_dictionary.end(), colv);
+      if (it == proc_id_dictionary.end()) {
+        proc_id_dictionary.push_back(colv);
+        hf.add_column(fmt::format("{}", colv));
+        it = proc_id_dictionary.end() - 1;
+      }
+      hf.fill_bin(bin, weight, 1 + (it - proc_id_dictionary.begin()));
+    }
+    return hf.num_fills;
+  };
+
+  BENCHMARK("[batch] 100 procid columns, n = 1E7") {
+    nuis::HistFrame hf(bins);
+    nuis::fill_procid_columns_from_EventFrame(hf, ef, {"x"});
+    return hf.num_fills;
+  };
+}
@@ -0,0 +1,183 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/matchers/catch_matchers_floating_point.hpp"
+
+#include "nuis/binning/exceptions.h"
+#include "nuis/histframe/HistFrame.h"
+#include "nuis/histframe/exceptions.h"
+#include "nuis/histframe/fill_from_EventFrame.h"
+#include "nuis/log.txx"
+
+#include <cassert>
+#include <thread>
+
+TEST_CASE("HistFrame::merge", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(0, 10, 10);
+
+  nuis::HistFrame all(bins), first(bins), second(bins);
+
+  for (int i = 0; i < 100; ++i) {
+    double x = (i * 7) % 10 + 0.5;
+    double w = 1 + (i % 3);
+    all.fill(x, w);
+    (i < 40 ? first : second).fill(x, w);
+  }
+
+  first.merge(second);
+
+  REQUIRE((first.sumweights == all.sumweights).all());
+  REQUIRE((first.variances == all.variances).all());
+  REQUIRE(first.num_fills == all.num_fills);
+}
+
+TEST_CASE("HistFrame::merge incompatible", "[HistFrame]") {
+  nuis::HistFrame hf1(nuis::Binning::lin_space(0, 10, 10));
+  nuis::HistFrame hf2(nuis::Binning::lin_space(0, 10, 5));
+
+  REQUIRE_THROWS_AS(hf1.merge(hf2), nuis::IncompatibleHistFrames);
+}
+
+TEST_CASE("HistFrame 1D fill from many threads", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(0, 10, 10);
+
+  size_t nthreads = 8;
+  size_t nfills = 10000;
+  std::vector<nuis::HistFrame> hfs(nthreads, nuis::HistFrame(bins));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < nfills; ++i) {
+        hfs[t].fill(double((i + t) % 10) + 0.5, 1);
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  for (auto const &hf : hfs) {
+    REQUIRE(hf.num_fills == nfills);
+    REQUIRE((hf.sumweights.col(0) == double(nfills / 10)).all());
+  }
+}
+
+TEST_CASE("HistFrame::concurrent_filler", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(0, 10, 10);
+
+  nuis::HistFrame hf(bins);
+  hf.add_column("other");
+  hf.resize();
+  hf.fill(0.5, 1);
+
+  nuis::HistFrame serial = hf;
+
+  size_t nthreads = 8;
+  size_t nfills = 10000;
+  auto filler = hf.concurrent_filler(nthreads);
+  REQUIRE(filler.size() == nthreads);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < nfills; ++i) {
+        filler[t].fill_column(double((i + t) % 10) + 0.5, 0.5 + t, t % 2);
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  for (size_t t = 0; t < nthreads; ++t) {
+    for (size_t i = 0; i < nfills; ++i) {
+      serial.fill_column(double((i + t) % 10) + 0.5, 0.5 + t, t % 2);
+    }
+  }
+
+  // nothing reaches the parent until the merge
+  REQUIRE(hf.num_fills == 1);
+
+  filler.merge();
+  REQUIRE(hf.num_fills == serial.num_fills);
+  REQUIRE((hf.sumweights == serial.sumweights).all());
+  REQUIRE((hf.variances == serial.variances).all());
+
+  // the accumulators are reset by the merge
+  REQUIRE(filler[0].num_fills == 0);
+  REQUIRE((filler.finalise().values == serial.finalise().values).all());
+}
+
+TEST_CASE("HistFrame::fill_bins", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(0, 10, 10);
+
+  nuis::HistFrame hf(bins), serial(bins);
+  hf.add_column("other");
+  hf.resize();
+  serial.add_column("other");
+  serial.resize();
+
+  nuis::Binning::BinIndices bis(5);
+  bis << 0, 3, nuis::Binning::npos, 3, 9;
+  Eigen::ArrayXd ws(5);
+  ws << 1, 2, 3, 0, 5;
+  nuis::HistFrame::ColumnIndices cols(5);
+  cols << 1, nuis::HistFrame::npos, 1, 1, 0;
+
+  hf.fill_bins(bis, ws, 0);
+  hf.fill_bins(bis, ws, cols);
+  for (int i = 0; i < 5; ++i) {
+    serial.fill_bin(bis[i], ws[i], 0);
+    if (cols[i] != nuis::HistFrame::npos) {
+      serial.fill_bin(bis[i], ws[i], cols[i]);
+    }
+  }
+
+  REQUIRE((hf.sumweights == serial.sumweights).all());
+  REQUIRE((hf.variances == serial.variances).all());
+  REQUIRE(hf.num_fills == serial.num_fills);
+
+  REQUIRE_THROWS_AS(hf.fill_bins(bis, ws.head(4), 0),
+                    nuis::MismatchedAxisCount);
+}
+
+TEST_CASE("fill_procid_columns_from_EventFrame_if", "[HistFrame]") {
+  auto bins = nuis::Binning::lin_space(0, 10, 10);
+
+  nuis::EventFrame ef;
+  ef.column_names = {"cond", "x", "process.id", "weight.cv"};
+  ef.table = Eigen::ArrayXXd::Zero(1000, 4);
+  for (int i = 0; i < 1000; ++i) {
+    ef.table(i, 0) = (i % 3) != 0;
+    ef.table(i, 1) = (i * 7) % 11 - 0.5;
+    ef.table(i, 2) = 200 + (i / 50) % 4;
+    ef.table(i, 3) = 1 + (i % 5);
+  }
+
+  nuis::HistFrame hf(bins);
+  nuis::fill_procid_columns_from_EventFrame_if(hf, ef, "cond", {"x"});
+
+  nuis::HistFrame serial(bins);
+  std::vector<int> procids;
+  for (int i = 0; i < 1000; ++i) {
+    if (ef.table(i, 0) == 0) {
+      continue;
+    }
+    int procid = ef.table(i, 2);
+    auto it = std::find(procids.begin(), procids.end(), procid);
+    if (it == procids.end()) {
+      procids.push_back(procid);
+      serial.add_column(std::to_string(procid));
+      it = procids.end() - 1;
+    }
+    auto bi = serial.find_bin(ef.table(i, 1));
+    serial.fill_bin(bi, ef.table(i, 3), 0);
+    serial.fill_bin(bi, ef.table(i, 3), 1 + (it - procids.begin()));
+  }
+
+  REQUIRE(hf.column_info.size() == serial.column_info.size());
+  for (size_t i = 0; i < hf.column_info.size(); ++i) {
+    REQUIRE(hf.column_info[i].name == serial.column_info[i].name);
+  }
+  REQUIRE((hf.sumweights == serial.sumweights).all());
+  REQUIRE((hf.variances == serial.variances).all());
+  REQUIRE(hf.num_fills == serial.num_fills);
+}
@@ -0,0 +1,240 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/matchers/catch_matchers_floating_point.hpp"
+
+#include "nuis/record/FrozenSelection.h"
+#include "nuis/record/fill_tables.h"
+
+#include "nuis/eventinput/EventParticleView.h"
+
+#include "StubEventSource.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace nuis;
+
+namespace {
+
+size_t const nstub_events = 4500;
+std::vector<double> const stub_weights = {1, 0.5, 2, 1.5};
+
+INormalizedEventSourcePtr
+stub_source(size_t nevents = nstub_events,
+            size_t throw_entry = std::numeric_limits<size_t>::max()) {
+  return std::make_shared<INormalizedEventSource>(
+      std::make_shared<test::StubEventSource>(nevents, stub_weights, 2.5,
+                                              throw_entry));
+}
+
+double enu(HepMC3::GenEvent const &ev) {
+  return EventParticleView::current(ev).beam()->momentum().e();
+}
+
+size_t npip(HepMC3::GenEvent const &ev) {
+  return EventParticleView::current(ev).final_state(211).size();
+}
+
+struct Normalization {
+  double fatx_per_sumw = 0;
+};
+
+// events with a pi+ in bins of neutrino energy, weighted by the number of pi+
+TablePtr enu_table(std::shared_ptr<Normalization> norm) {
+  auto tab = std::make_shared<Table>();
+  tab->blueprint =
+      std::make_shared<Comparison>(Binning::lin_space(0, 5E5, 50, "enu"));
+  tab->select = [](HepMC3::GenEvent const &ev) { return int(npip(ev) > 0); };
+  tab->weight = [](HepMC3::GenEvent const &ev) { return double(npip(ev)); };
+  tab->projections = {enu};
+  tab->finalize = [=](Comparison &comp, double fatx_per_sumw) {
+    norm->fatx_per_sumw = fatx_per_sumw;
+    return comp.mc.finalise(false);
+  };
+  return tab;
+}
+
+// every event, in bins of muon momentum and number of pi+
+TablePtr pmu_table() {
+  auto tab = std::make_shared<Table>();
+  tab->blueprint = std::make_shared<Comparison>(
+      Binning::lin_spaceND({{0, 3E5, 30}, {0, 3, 3}}, {"pmu", "npip"}));
+  tab->project = [](HepMC3::GenEvent const &ev) {
+    auto mu = EventParticleView::current(ev).highest_momentum(13);
+    return std::vector<double>{mu->momentum().p3mod(), double(npip(ev))};
+  };
+  return tab;
+}
+
+void require_same_hist(HistFrame const &a, HistFrame const &b) {
+  REQUIRE(a.num_fills == b.num_fills);
+  REQUIRE(a.sumweights.rows() == b.sumweights.rows());
+  for (Eigen::Index i = 0; i < a.sumweights.rows(); ++i) {
+    REQUIRE_THAT(a.sumweights(i, 0),
+                 Catch::Matchers::WithinRel(b.sumweights(i, 0), 1E-12));
+    REQUIRE_THAT(a.variances(i, 0),
+                 Catch::Matchers::WithinRel(b.variances(i, 0), 1E-12));
+  }
+}
+
+struct HookError : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+} // namespace
+
+TEST_CASE("fill_tables threaded matches serial", "[Record]") {
+  // a single batch, a limit that lands part way through a batch, and the whole
+  // source
+  for (size_t max_events : {size_t(700), size_t(2500),
+                            std::numeric_limits<size_t>::max()}) {
+    size_t nread = std::min(max_events, nstub_events);
+
+    auto serial_norm = std::make_shared<Normalization>();
+    auto serial_evs = stub_source();
+    auto serial = fill_tables({enu_table(serial_norm), pmu_table()},
+                              serial_evs, max_events, 1);
+
+    REQUIRE(serial_evs->norm_info().nevents == nread);
+    // every event read is filled into the pmu table
+    REQUIRE(serial[1].mc.num_fills == nread);
+    // one in three events has no pi+
+    REQUIRE(serial[0].mc.num_fills == (nread - ((nread + 2) / 3)));
+
+    auto threaded_norm = std::make_shared<Normalization>();
+    auto threaded_evs = stub_source();
+    auto threaded = fill_tables({enu_table(threaded_norm), pmu_table()},
+                                threaded_evs, max_events, 4);
+
+    REQUIRE(threaded_evs->norm_info().nevents == nread);
+    REQUIRE(threaded_evs->norm_info().sumweights ==
+            serial_evs->norm_info().sumweights);
+    REQUIRE(threaded_norm->fatx_per_sumw == serial_norm->fatx_per_sumw);
+
+    REQUIRE(threaded.size() == 2);
+    require_same_hist(threaded[0].mc, serial[0].mc);
+    require_same_hist(threaded[1].mc, serial[1].mc);
+  }
+}
+
+TEST_CASE("fill_tables max_events 0", "[Record]") {
+  for (size_t nthreads : {1, 4}) {
+    auto norm = std::make_shared<Normalization>();
+    auto filled =
+        fill_tables({enu_table(norm), pmu_table()}, stub_source(), 0, nthreads);
+    REQUIRE(filled[0].mc.num_fills == 0);
+    REQUIRE(filled[1].mc.num_fills == 0);
+  }
+}
+
+TEST_CASE("fill_tables hook exceptions", "[Record]") {
+  for (size_t nthreads : {1, 4}) {
+    // in the first batch, in a later batch, and the last event
+    for (int throw_at : {10, 1700, int(nstub_events) - 1}) {
+      auto tab = pmu_table();
+      tab->select = [=](HepMC3::GenEvent const &ev) {
+        if (ev.event_number() == throw_at) {
+          throw HookError("select failed");
+        }
+        return 1;
+      };
+      auto norm = std::make_shared<Normalization>();
+      REQUIRE_THROWS_AS(fill_tables({enu_table(norm), tab}, stub_source(),
+                                    nstub_events, nthreads),
+                        HookError);
+    }
+
+    // and from reading the source
+    REQUIRE_THROWS_AS(fill_tables({pmu_table()},
+                                  stub_source(nstub_events, 2100),
+                                  nstub_events, nthreads),
+                      test::StubEventSourceError);
+  }
+}
+
+TEST_CASE("FrozenSelection matches fill_tables", "[Record]") {
+  auto norm = std::make_shared<Normalization>();
+  FrozenSelection frozen({enu_table(norm), pmu_table()}, stub_source(), 2500);
+  // every event is selected by the pmu table
+  REQUIRE(frozen.size() == 2500);
+  REQUIRE(frozen.norm_info().nevents == 2500);
+
+  auto evaluated = frozen.evaluate();
+  double frozen_fatx_per_sumw = norm->fatx_per_sumw;
+
+  auto filled =
+      fill_tables({enu_table(norm), pmu_table()}, stub_source(), 2500);
+  REQUIRE(frozen_fatx_per_sumw == norm->fatx_per_sumw);
+
+  REQUIRE(evaluated.size() == 2);
+  require_same_hist(evaluated[0].mc, filled[0].mc);
+  require_same_hist(evaluated[1].mc, filled[1].mc);
+
+  // evaluating again gives the same result
+  auto reevaluated = frozen.evaluate();
+  require_same_hist(reevaluated[0].mc, evaluated[0].mc);
+  require_same_hist(reevaluated[1].mc, evaluated[1].mc);
+}
+
+TEST_CASE("FrozenSelection max_events 0", "[Record]") {
+  auto norm = std::make_shared<Normalization>();
+  FrozenSelection frozen({enu_table(norm), pmu_table()}, stub_source(), 0);
+  REQUIRE(frozen.size() == 0);
+  auto evaluated = frozen.evaluate();
+  REQUIRE(evaluated[0].mc.num_fills == 0);
+  REQUIRE(evaluated[1].mc.num_fills == 0);
+}
+
+TEST_CASE("FrozenSelection event weights", "[Record]") {
+  auto reweight = [](HepMC3::GenEvent const &ev) {
+    return 0.5 + 1E-3 * ev.event_number();
+  };
+
+  auto norm = std::make_shared<Normalization>();
+  FrozenSelection frozen({enu_table(norm), pmu_table()}, stub_source());
+  auto evaluated = frozen.evaluate(reweight);
+
+  // the same reweighting applied through the table weight hooks
+  auto enu_tab = enu_table(norm);
+  auto enu_weight = enu_tab->weight;
+  enu_tab->weight = [=](HepMC3::GenEvent const &ev) {
+    return enu_weight(ev) * reweight(ev);
+  };
+  auto pmu_tab = pmu_table();
+  pmu_tab->weight = reweight;
+  auto filled = fill_tables({enu_tab, pmu_tab}, stub_source());
+
+  require_same_hist(evaluated[0].mc, filled[0].mc);
+  require_same_hist(evaluated[1].mc, filled[1].mc);
+
+  // a constant event weight scales the unweighted estimate
+  auto unweighted = frozen.evaluate();
+  auto scaled = frozen.evaluate([](HepMC3::GenEvent const &) { return 3.; });
+  for (size_t ti = 0; ti < 2; ++ti) {
+    for (Eigen::Index i = 0; i < scaled[ti].mc.sumweights.rows(); ++i) {
+      REQUIRE_THAT(scaled[ti].mc.sumweights(i, 0),
+                   Catch::Matchers::WithinRel(
+                       3 * unweighted[ti].mc.sumweights(i, 0), 1E-12));
+      REQUIRE_THAT(scaled[ti].mc.variances(i, 0),
+                   Catch::Matchers::WithinRel(
+                       9 * unweighted[ti].mc.variances(i, 0), 1E-12));
+    }
+  }
+}
+
+TEST_CASE("FrozenSelection drops zero weight events", "[Record]") {
+  // every other event has a CV weight of 0
+  auto evs = std::make_shared<INormalizedEventSource>(
+      std::make_shared<test::StubEventSource>(100, std::vector<double>{1, 0}));
+  FrozenSelection frozen({pmu_table()}, evs);
+  REQUIRE(frozen.size() == 50);
+  // they still count towards the normalization
+  REQUIRE(frozen.norm_info().nevents == 100);
+
+  // and cannot be given weight again
+  auto evaluated =
+      frozen.evaluate([](HepMC3::GenEvent const &) { return 2.; });
+  REQUIRE(evaluated[0].mc.num_fills == 50);
+  REQUIRE(evaluated[0].mc.sumweights.sum() == 100);
+}
@@ -0,0 +1,71 @@
+#include "catch2/benchmark/catch_benchmark.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+#include "nuis/response/FramedResponse.h"
+
+#include <random>
+
+template <typename P> void benchmark_eval_batch(char const *precision) {
+  std::default_random_engine e1(1);
+  std::uniform_real_distribution<> uni(0, 2);
+
+  Eigen::ArrayXd x{{-3, -2, -1, 0, 1, 2, 3}};
+  Eigen::ArrayXXd y(10000, x.size());
+  for (int i = 0; i < y.rows(); ++i) {
+    for (int j = 0; j < y.cols(); ++j) {
+      y(i, j) = uni(e1);
+    }
+  }
+
+  nuis::NaturalCubicFrameSpline<Eigen::Dynamic, P> sp(x);
+  sp.build(y.cast<P>());
+
+  Eigen::ColArrayX<P> vals = Eigen::ColArrayX<P>::LinSpaced(1000, -3, 3);
+
+  BENCHMARK(std::string("[eval] 1E4 rows, 1E3 values, ") + precision) {
+    P sum = 0;
+    for (Eigen::Index j = 0; j < vals.size(); ++j) {
+      sum += sp.eval(vals[j]).sum();
+    }
+    return sum;
+  };
+
+  BENCHMARK(std::string("[eval_batch] 1E4 rows, 1E3 values, ") + precision) {
+    return sp.eval_batch(vals).sum();
+  };
+}
+
+template <typename P> void benchmark_build(char const *precision) {
+  std::default_random_engine e1(1);
+  std::uniform_real_distribution<> uni(0, 2);
+
+  Eigen::ArrayXd x{{-3, -2, -1, 0, 1, 2, 3}};
+  Eigen::ArrayXX<P> y(100000, x.size());
+  for (int i = 0; i < y.rows(); ++i) {
+    for (int j = 0; j < y.cols(); ++j) {
+      y(i, j) = uni(e1);
+    }
+  }
+
+  nuis::NaturalCubicFrameSpline<Eigen::Dynamic, P> sp(x);
+  BENCHMARK(std::string("[build] 1E5 rows, 7 knots, ") + precision) {
+    sp.build(y);
+    return sp.coeffs(0, 0);
+  };
+
+  nuis::NaturalCubicFrameSpline<7, P> sp7{Eigen::ColArray<7, double>(x)};
+  BENCHMARK(std::string("[build] 1E5 rows, N=7, ") + precision) {
+    sp7.build(y);
+    return sp7.coeffs(0, 0);
+  };
+}
+
+TEST_CASE("NaturalCubicFrameSpline::build", "[Response]") {
+  benchmark_build<float>("float");
+  benchmark_build<double>("double");
+}
+
+TEST_CASE("NaturalCubicFrameSpline::eval_batch", "[Response]") {
+  benchmark_eval_batch<float>("float");
+  benchmark_eval_batch<double>("double");
+}
@@ -1,6 +1,7 @@
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/matchers/catch_matchers_floating_point.hpp"
 
+#include "nuis/response/BinnedResponse.h"
 #include "nuis/response/FramedResponse.h"
 
 #include "spdlog/spdlog.h"
@@ -32,4 +33,200 @@ TEST_CASE("FramedResponse", "[Response]") {
   nuis::GaussRBFInterpolXd rbf(x2);
   rbf.build(y);
   std::cout << "coeffs: " << rbf.coeffs << std::endl;
-}
\ No newline at end of file
+}
+
+TEST_CASE("BinnedSplineResponse", "[Response]") {
+  auto bins = nuis::Binning::lin_space(0, 3, 3);
+
+  // each bin responds linearly to the dial, which the natural cubic spline
+  // reproduces exactly
+  auto predict = [&](double x) {
+    nuis::BinnedValues bv(bins);
+    bv.values.col(0) << 1 + x, 2 - x, 3 + 2 * x;
+    bv.errors.col(0) << 0.1, 0.2, 0.3;
+    return bv;
+  };
+
+  nuis::BinnedSplineResponse resp({-2, -1, 0, 1, 2}, predict);
+
+  for (double x : {-2.0, -0.5, 0.0, 0.25, 1.5, 2.0}) {
+    auto bv = resp.eval(x);
+    auto expected = predict(x);
+    REQUIRE(bv.binning == bins);
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE_THAT(bv.values(i, 0),
+                   Catch::Matchers::WithinAbs(expected.values(i, 0), 1E-8));
+      REQUIRE_THAT(bv.errors(i, 0),
+                   Catch::Matchers::WithinAbs(expected.errors(i, 0), 1E-8));
+    }
+  }
+
+  REQUIRE_THROWS_AS(nuis::BinnedSplineResponse({0, 1}, predict),
+                    nuis::InvalidBinnedPrediction);
+
+  // a separately built binning with the same extents is compatible, a binning
+  // with different extents is not
+  std::vector<nuis::BinnedValues> preds = {predict(-1), predict(0), predict(1)};
+  preds[1].binning = nuis::Binning::lin_space(0, 3, 3);
+  REQUIRE_NOTHROW(nuis::BinnedSplineResponse({-1, 0, 1}, preds));
+  preds[2].binning = nuis::Binning::lin_space(0, 6, 3);
+  REQUIRE_THROWS_AS(nuis::BinnedSplineResponse({-1, 0, 1}, preds),
+                    nuis::InvalidBinnedPrediction);
+}
+
+TEST_CASE("BinnedRBFResponse", "[Response]") {
+  auto bins = nuis::Binning::lin_space(0, 2, 2);
+
+  auto predict = [&](Eigen::RowArrayXd const &p) {
+    nuis::BinnedValues bv(bins);
+    bv.values.col(0) << 1 + p[0] * p[1], 2 + p[0] - p[1];
+    bv.errors.col(0) << 0.1, 0.2;
+    return bv;
+  };
+
+  Eigen::ArrayXXd knots(9, 2);
+  for (int i = 0; i < 9; ++i) {
+    knots.row(i) << (i % 3) - 1, (i / 3) - 1;
+  }
+
+  nuis::BinnedRBFResponse resp({"a", "b"}, knots, predict);
+
+  // the interpolation is exact at the knots
+  for (int i = 0; i < 9; ++i) {
+    auto bv = resp.eval({{"a", knots(i, 0)}, {"b", knots(i, 1)}});
+    auto expected = predict(knots.row(i));
+    for (int j = 0; j < 2; ++j) {
+      REQUIRE_THAT(bv.values(j, 0),
+                   Catch::Matchers::WithinAbs(expected.values(j, 0), 1E-6));
+    }
+  }
+
+  REQUIRE_THROWS_AS(resp.eval({{"a", 0}}), nuis::InvalidBinnedPrediction);
+}
+
+TEST_CASE("NaturalCubicFrameSpline::eval_batch", "[Response]") {
+  std::default_random_engine e1(1);
+  std::uniform_real_distribution<> uni(0, 2);
+
+  Eigen::ArrayXd x{{-2, -1, 0, 1, 2}};
+  Eigen::ArrayXXd y(100, 5);
+  for (int i = 0; i < y.rows(); ++i) {
+    for (int j = 0; j < y.cols(); ++j) {
+      y(i, j) = uni(e1);
+    }
+  }
+
+  nuis::NaturalCubicFrameSplineXd sp(x);
+  sp.build(y);
+
+  // passes through the knots
+  for (int j = 0; j < x.size(); ++j) {
+    auto ev = sp.eval(x[j]);
+    for (int i = 0; i < y.rows(); ++i) {
+      REQUIRE_THAT(ev[i], Catch::Matchers::WithinAbs(y(i, j), 1E-12));
+    }
+  }
+
+  Eigen::ArrayXd vals{{-2, -1.5, -0.3, 0, 0.7, 1.99, 2}};
+  auto batch = sp.eval_batch(vals);
+  REQUIRE(batch.rows() == y.rows());
+  REQUIRE(batch.cols() == vals.size());
+  for (int j = 0; j < vals.size(); ++j) {
+    REQUIRE((batch.col(j) == sp.eval(vals[j])).all());
+  }
+
+  nuis::NaturalCubicFrameSpline5f spf{Eigen::ColArray<5, double>(x)};
+  spf.build(y.cast<float>());
+  Eigen::ArrayXf fvals = vals.cast<float>();
+  auto fbatch = spf.eval_batch(fvals);
+  for (int j = 0; j < vals.size(); ++j) {
+    REQUIRE((fbatch.col(j) - batch.col(j).cast<float>()).abs().maxCoeff() <
+            1E-4);
+  }
+
+  REQUIRE_THROWS_AS(sp.eval(2.01), nuis::EvalOutOfValidityRange);
+  REQUIRE_THROWS_AS(sp.eval_batch(Eigen::ArrayXd{{0, -3}}),
+                    nuis::EvalOutOfValidityRange);
+}
+
+// solves for the coefficients of every row with a dense solve of the full
+// spline system, as NaturalCubicFrameSpline::build used to
+Eigen::ArrayXXd dense_spline_coeffs(Eigen::ArrayXd const &x,
+                                    Eigen::ArrayXXd const &y) {
+  int n = x.size();
+  Eigen::ArrayXd h = x.tail(n - 1) - x.head(n - 1);
+
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n);
+  A(0, 0) = 1;
+  A(n - 1, n - 1) = 1;
+  for (int i = 1; i < (n - 1); ++i) {
+    A(i, i - 1) = h(i - 1);
+    A(i, i) = 2.0 * (h(i - 1) + h(i));
+    A(i, i + 1) = h(i);
+  }
+
+  Eigen::ArrayXXd coeffs(y.rows(), 4 * (n - 1));
+  for (int row = 0; row < y.rows(); ++row) {
+    Eigen::VectorXd alpha = Eigen::VectorXd::Zero(n);
+    for (int i = 1; i < (n - 1); ++i) {
+      alpha(i) = (3.0 / h(i)) * (y(row, i + 1) - y(row, i)) -
+                 (3.0 / h(i - 1)) * (y(row, i) - y(row, i - 1));
+    }
+    Eigen::VectorXd c = A.colPivHouseholderQr().solve(alpha);
+    for (int seg = 0; seg < (n - 1); ++seg) {
+      coeffs(row, 4 * seg) = y(row, seg);
+      coeffs(row, 4 * seg + 1) =
+          (y(row, seg + 1) - y(row, seg)) / h(seg) -
+          (h(seg) / 3.0) * (2.0 * c(seg) + c(seg + 1));
+      coeffs(row, 4 * seg + 2) = c(seg);
+      coeffs(row, 4 * seg + 3) = (c(seg + 1) - c(seg)) / (3.0 * h(seg));
+    }
+  }
+  return coeffs;
+}
+
+TEST_CASE("NaturalCubicFrameSpline::build", "[Response]") {
+  std::default_random_engine e1(2);
+  std::uniform_real_distribution<> uni(-5, 5);
+
+  // unevenly spaced knots
+  Eigen::ArrayXd x{{-3, -2.5, -1, 0, 0.2, 1.5, 4}};
+  Eigen::ArrayXXd y(200, x.size());
+  for (int i = 0; i < y.rows(); ++i) {
+    for (int j = 0; j < y.cols(); ++j) {
+      y(i, j) = uni(e1);
+    }
+  }
+
+  auto ref = dense_spline_coeffs(x, y);
+
+  nuis::NaturalCubicFrameSplineXd sp(x);
+  sp.build(y);
+  REQUIRE(sp.coeffs.rows() == ref.rows());
+  REQUIRE(sp.coeffs.cols() == ref.cols());
+  REQUIRE((sp.coeffs - ref).abs().maxCoeff() < 1E-12);
+
+  nuis::NaturalCubicFrameSpline<7, double> sp7{Eigen::ColArray<7, double>(x)};
+  sp7.build(y);
+  REQUIRE((sp7.coeffs - ref).abs().maxCoeff() < 1E-12);
+
+  nuis::NaturalCubicFrameSplineXf spf(x);
+  spf.build(y.cast<float>());
+  REQUIRE((spf.coeffs.cast<double>() - ref).abs().maxCoeff() < 1E-4);
+
+  // natural boundary conditions and a continuous second derivative
+  Eigen::ArrayXd h = x.tail(x.size() - 1) - x.head(x.size() - 1);
+  int nseg = x.size() - 1;
+  for (int i = 0; i < y.rows(); ++i) {
+    REQUIRE_THAT(sp.coeffs(i, 2), Catch::Matchers::WithinAbs(0, 1E-12));
+    REQUIRE_THAT(sp.coeffs(i, 4 * (nseg - 1) + 2) +
+                     3.0 * sp.coeffs(i, 4 * (nseg - 1) + 3) * h(nseg - 1),
+                 Catch::Matchers::WithinAbs(0, 1E-10));
+    for (int seg = 0; seg < (nseg - 1); ++seg) {
+      REQUIRE_THAT(sp.coeffs(i, 4 * seg + 2) +
+                       3.0 * sp.coeffs(i, 4 * seg + 3) * h(seg),
+                   Catch::Matchers::WithinAbs(sp.coeffs(i, 4 * (seg + 1) + 2),
+                                              1E-10));
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "nuis/eventinput/IEventSource.h"
+
+#include "NuHepMC/Constants.hxx"
+#include "NuHepMC/WriterUtils.hxx"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenRunInfo.h"
+#include "HepMC3/GenVertex.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Minimal in-memory event sources for tests that need events but no input
+// files
+
+namespace nuis::test {
+
+inline std::shared_ptr<HepMC3::GenRunInfo> stub_run_info(double fatx = 1) {
+  auto run_info = std::make_shared<HepMC3::GenRunInfo>();
+  NuHepMC::GR2::WriteVersion(run_info);
+  run_info->tools().emplace_back(
+      HepMC3::GenRunInfo::ToolInfo{"nuis-tests", "0", ""});
+  NuHepMC::GR7::SetWeightNames(run_info, {"CV"});
+  NuHepMC::GC4::SetCrossSectionUnits(run_info, "pb", "PerTargetAtom");
+  NuHepMC::GC5::SetFluxAveragedTotalXSec(run_info, fatx);
+  NuHepMC::GC1::SetConventions(run_info, {"G.C.1", "G.C.4", "G.C.5"});
+  return run_info;
+}
+
+// Event i has a muon neutrino beam with energy 100*(i+1) MeV incident on a
+// carbon target, a final state muon carrying 60% of the beam energy, and
+// i%3 final state pi+ with decreasing momenta. The process ID is 200 + i%3 and
+// the CV weight is weight.
+inline std::shared_ptr<HepMC3::GenEvent>
+stub_event(std::shared_ptr<HepMC3::GenRunInfo> run_info, int i,
+           double weight = 1) {
+  auto evt = std::make_shared<HepMC3::GenEvent>(HepMC3::Units::MEV,
+                                                HepMC3::Units::MM);
+  evt->set_run_info(run_info);
+  evt->set_event_number(i);
+
+  auto vtx = std::make_shared<HepMC3::GenVertex>();
+  vtx->set_status(NuHepMC::VertexStatus::Primary);
+  evt->add_vertex(vtx);
+
+  double enu = 100 * (i + 1);
+  vtx->add_particle_in(std::make_shared<HepMC3::GenParticle>(
+      HepMC3::FourVector{0, 0, enu, enu}, 14,
+      NuHepMC::ParticleStatus::IncomingBeam));
+  vtx->add_particle_in(std::make_shared<HepMC3::GenParticle>(
+      HepMC3::FourVector{0, 0, 0, 11177.9}, 1000060120,
+      NuHepMC::ParticleStatus::Target));
+
+  double pmu = 0.6 * enu;
+  vtx->add_particle_out(std::make_shared<HepMC3::GenParticle>(
+      HepMC3::FourVector{0, 0, pmu, std::sqrt(pmu * pmu + 105.66 * 105.66)},
+      13, NuHepMC::ParticleStatus::UndecayedPhysical));
+
+  for (int j = 0; j < (i % 3); ++j) {
+    double ppi = 0.1 * enu / (j + 1);
+    vtx->add_particle_out(std::make_shared<HepMC3::GenParticle>(
+        HepMC3::FourVector{ppi, 0, 0, std::sqrt(ppi * ppi + 139.57 * 139.57)},
+        211, NuHepMC::ParticleStatus::UndecayedPhysical));
+  }
+
+  NuHepMC::ER3::SetProcessID(*evt, 200 + (i % 3));
+  evt->weights() = {weight};
+  return evt;
+}
+
+struct StubEventSourceError : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Returns nevents events built by stub_event, event i having CV weight
+// weights[i % weights.size()]. If throw_at is set, reading that entry throws
+// StubEventSourceError.
+class StubEventSource : public IEventSource {
+  std::shared_ptr<HepMC3::GenRunInfo> run_info;
+  size_t nevents;
+  std::vector<double> weights;
+  size_t throw_at;
+  size_t ientry;
+
+  std::shared_ptr<HepMC3::GenEvent> read() {
+    if (ientry == throw_at) {
+      throw StubEventSourceError("stub source failed at entry " +
+                                 std::to_string(ientry));
+    }
+    if (ientry >= nevents) {
+      return nullptr;
+    }
+    auto w = weights.size() ? weights[ientry % weights.size()] : 1;
+    return stub_event(run_info, int(ientry), w);
+  }
+
+public:
+  size_t nfirst = 0;
+
+  StubEventSource(size_t nev, std::vector<double> w = {}, double fatx = 1,
+                  size_t throw_entry = std::numeric_limits<size_t>::max())
+      : run_info{stub_run_info(fatx)}, nevents{nev}, weights{w},
+        throw_at{throw_entry}, ientry{0} {}
+
+  std::shared_ptr<HepMC3::GenEvent> first() {
+    nfirst++;
+    ientry = 0;
+    return read();
+  }
+  std::shared_ptr<HepMC3::GenEvent> next() {
+    ientry++;
+    return read();
+  }
+};
+
+} // namespace nuis::test
@@ -0,0 +1,268 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/matchers/catch_matchers_floating_point.hpp"
+
+#include "nuis/weightcalc/SplineWeightCalc.h"
+#include "nuis/weightcalc/WeightCalcFunc.h"
+#include "nuis/weightcalc/plugins/IWeightCalcPlugin.h"
+
+#include "nuis/eventinput/IRangedEventSource.h"
+
+#include "StubEventSource.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace nuis;
+using Catch::Matchers::WithinRel;
+
+namespace {
+
+double dial_value(std::map<std::string, double> const &params,
+                  std::string const &name) {
+  return params.count(name) ? params.at(name) : 0;
+}
+
+// a cubic response to x and a linear response to y, that differ from event to
+// event and factorize
+double cubic_weight(HepMC3::GenEvent const &ev,
+                    std::map<std::string, double> const &params) {
+  double x = dial_value(params, "x");
+  double y = dial_value(params, "y");
+  double a = 0.1 * (1 + (ev.event_number() % 3));
+  double enu = ev.particles().front()->momentum().e();
+  return (enu / 100.) * (1 + a * x + 0.05 * x * x + 0.02 * x * x * x) *
+         (1 + 0.2 * y);
+}
+
+std::vector<std::shared_ptr<HepMC3::GenEvent>> stub_events(size_t n) {
+  auto run_info = test::stub_run_info();
+  std::vector<std::shared_ptr<HepMC3::GenEvent>> evs;
+  for (size_t i = 0; i < n; ++i) {
+    evs.push_back(test::stub_event(run_info, int(i)));
+  }
+  return evs;
+}
+
+SplineWeightCalc::DialKnots const knots = {
+    {"x", {-2, -1.5, -1, -0.5, 0, 0.5, 1, 1.5, 2}},
+    {"y", {-1, 0, 1}},
+};
+
+} // namespace
+
+TEST_CASE("SplineWeightCalc reproduces the weight calculator",
+          "[WeightCalc]") {
+  auto wc = std::make_shared<WeightCalcFuncHM3Map>(cubic_weight);
+  SplineWeightCalc swc(
+      wc,
+      std::make_shared<INormalizedEventSource>(
+          std::make_shared<test::StubEventSource>(10)),
+      knots, {}, std::numeric_limits<size_t>::max(), 4);
+  REQUIRE(swc.size() == 10);
+
+  auto events = stub_events(10);
+
+  // at the knots, where the spline interpolates exactly up to float precision
+  for (double x : knots.at("x")) {
+    for (double y : knots.at("y")) {
+      std::map<std::string, double> params = {{"x", x}, {"y", y}};
+      swc.set_parameters(params);
+      wc->set_parameters(params);
+      for (auto const &ev : events) {
+        REQUIRE_THAT(swc.calc_weight(*ev),
+                     WithinRel(wc->calc_weight(*ev), 1E-5));
+      }
+    }
+  }
+
+  // and between them, where a natural spline only approximates a cubic
+  for (double x : {-1.75, -0.3, 0.25, 1.1, 1.9}) {
+    for (double y : {-0.5, 0.7}) {
+      std::map<std::string, double> params = {{"x", x}, {"y", y}};
+      swc.set_parameters(params);
+      wc->set_parameters(params);
+      for (auto const &ev : events) {
+        REQUIRE_THAT(swc.calc_weight(*ev),
+                     WithinRel(wc->calc_weight(*ev), 1E-2));
+      }
+    }
+  }
+}
+
+TEST_CASE("SplineWeightCalc::set_parameters keeps unset dials",
+          "[WeightCalc]") {
+  auto wc = std::make_shared<WeightCalcFuncHM3Map>(cubic_weight);
+  SplineWeightCalc swc(wc,
+                       std::make_shared<INormalizedEventSource>(
+                           std::make_shared<test::StubEventSource>(5)),
+                       knots);
+  auto events = stub_events(5);
+
+  swc.set_parameters({{"x", 1}});
+  swc.set_parameters({{"y", -1}});
+  wc->set_parameters({{"x", 1}, {"y", -1}});
+  for (auto const &ev : events) {
+    REQUIRE_THAT(swc.calc_weight(*ev), WithinRel(wc->calc_weight(*ev), 1E-5));
+  }
+
+  // a failed update leaves the parameters unchanged
+  REQUIRE_THROWS_AS(swc.set_parameters({{"x", 0}, {"z", 1}}),
+                    InvalidSplineDial);
+  for (auto const &ev : events) {
+    REQUIRE_THAT(swc.calc_weight(*ev), WithinRel(wc->calc_weight(*ev), 1E-5));
+  }
+
+  swc.set_parameters({{"x", 0}, {"y", 0}});
+  wc->set_parameters({});
+  for (auto const &ev : events) {
+    REQUIRE_THAT(swc.calc_weight(*ev), WithinRel(wc->calc_weight(*ev), 1E-12));
+  }
+}
+
+TEST_CASE("SplineWeightCalc max_events", "[WeightCalc]") {
+  auto wc = std::make_shared<WeightCalcFuncHM3Map>(cubic_weight);
+  for (size_t max_events : {0, 1, 7}) {
+    SplineWeightCalc swc(wc,
+                         std::make_shared<INormalizedEventSource>(
+                             std::make_shared<test::StubEventSource>(10)),
+                         knots, {}, max_events);
+    REQUIRE(swc.size() == max_events);
+  }
+}
+
+TEST_CASE("SplineWeightCalc invalid dials and events", "[WeightCalc]") {
+  auto wc = std::make_shared<WeightCalcFuncHM3Map>(cubic_weight);
+  auto evs = std::make_shared<INormalizedEventSource>(
+      std::make_shared<test::StubEventSource>(5));
+
+  REQUIRE_THROWS_AS(SplineWeightCalc(wc, evs, {{"x", {-1, 1}}}),
+                    InvalidSplineDial);
+  REQUIRE_THROWS_AS(SplineWeightCalc(wc, evs, {{"x", {-1, 1, 0}}}),
+                    InvalidSplineDial);
+  // the nominal value must be a knot
+  REQUIRE_THROWS_AS(SplineWeightCalc(wc, evs, {{"x", {-1, 0.5, 1}}}),
+                    InvalidSplineDial);
+  REQUIRE_THROWS_AS(
+      SplineWeightCalc(wc, evs, {{"x", {-1, 0, 1}}}, {{"x", 0.5}}),
+      InvalidSplineDial);
+  REQUIRE_NOTHROW(
+      SplineWeightCalc(wc, evs, {{"x", {-1, 0.5, 1}}}, {{"x", 0.5}}));
+
+  SplineWeightCalc swc(wc, evs, knots);
+  REQUIRE_THROWS_AS(swc.set_parameters({{"z", 1}}), InvalidSplineDial);
+
+  auto unknown = test::stub_event(test::stub_run_info(), 5);
+  REQUIRE_THROWS_AS(swc.calc_weight(*unknown), SplineWeightCalcUnknownEvent);
+}
+
+namespace {
+// every event number appears twice
+class DuplicateEventNumberSource : public test::StubEventSource {
+public:
+  using test::StubEventSource::StubEventSource;
+
+  std::shared_ptr<HepMC3::GenEvent> first() {
+    auto ev = test::StubEventSource::first();
+    ev->set_event_number(ev->event_number() / 2);
+    return ev;
+  }
+  std::shared_ptr<HepMC3::GenEvent> next() {
+    auto ev = test::StubEventSource::next();
+    if (ev) {
+      ev->set_event_number(ev->event_number() / 2);
+    }
+    return ev;
+  }
+};
+} // namespace
+
+TEST_CASE("SplineWeightCalc duplicate event numbers", "[WeightCalc]") {
+  auto wc = std::make_shared<WeightCalcFuncHM3Map>(cubic_weight);
+  // events are matched by event number, so repeats are an error
+  REQUIRE_THROWS_AS(
+      SplineWeightCalc(wc,
+                       std::make_shared<INormalizedEventSource>(
+                           std::make_shared<DuplicateEventNumberSource>(10)),
+                       knots),
+      SplineWeightCalcDuplicateEvent);
+}
+
+namespace {
+// an input that can be split into shards
+class StubRangedEventSource : public IRangedEventSource {
+  std::shared_ptr<HepMC3::GenRunInfo> run_info;
+  size_t nevents;
+  size_t ientry;
+
+public:
+  StubRangedEventSource(size_t nev)
+      : run_info{test::stub_run_info()}, nevents{nev}, ientry{0} {}
+
+  std::shared_ptr<HepMC3::GenEvent> first() { return seek(0); }
+  std::shared_ptr<HepMC3::GenEvent> next() { return seek(ientry + 1); }
+
+  size_t num_entries() { return nevents; }
+  std::shared_ptr<HepMC3::GenEvent> seek(size_t i) {
+    ientry = std::min(i, nevents);
+    return (ientry < nevents) ? test::stub_event(run_info, int(ientry))
+                              : nullptr;
+  }
+  IEventSourcePtr make_shard(size_t begin, size_t end) {
+    return std::make_shared<RangedEventSourceShard>(
+        std::make_shared<StubRangedEventSource>(nevents), begin, end);
+  }
+};
+
+// like the generator reweighting plugins, only good for one input type
+class StubReWeightCalc : public IWeightCalcPlugin {
+  std::shared_ptr<StubRangedEventSource> source;
+  std::map<std::string, double> params;
+
+public:
+  StubReWeightCalc(IEventSourcePtr evs)
+      : source{std::dynamic_pointer_cast<StubRangedEventSource>(evs)} {}
+
+  double calc_weight(HepMC3::GenEvent const &ev) {
+    return cubic_weight(ev, params);
+  }
+  void set_parameters(std::map<std::string, double> const &p) { params = p; }
+  bool good() const { return bool(source); }
+};
+} // namespace
+
+TEST_CASE("Weight calculators for a sharded input", "[WeightCalc]") {
+  auto input = std::make_shared<StubRangedEventSource>(20);
+  auto shard = input->make_shard(5, 15);
+
+  // the shard itself is not an input the plugin can reweight, but it unwraps
+  // to one
+  REQUIRE(!StubReWeightCalc(shard).good());
+  auto wrapped = std::dynamic_pointer_cast<IEventSourceWrapper>(shard);
+  REQUIRE(wrapped);
+  REQUIRE(wrapped->as<StubRangedEventSource>());
+  REQUIRE(wrapped->wraps<StubRangedEventSource>());
+  REQUIRE(StubReWeightCalc(wrapped->unwrap()).good());
+
+  // also through further wrappers
+  auto evs = std::make_shared<INormalizedEventSource>(shard);
+  REQUIRE(evs->as<StubRangedEventSource>());
+  auto wc = std::make_shared<StubReWeightCalc>(evs->unwrap());
+  REQUIRE(wc->good());
+
+  SplineWeightCalc swc(wc, evs, knots);
+  REQUIRE(swc.size() == 10);
+  REQUIRE(evs->norm_info().nevents == 10);
+
+  std::map<std::string, double> params = {{"x", 1.5}, {"y", -1}};
+  swc.set_parameters(params);
+  wc->set_parameters(params);
+  for (auto const &ev : stub_events(15)) {
+    if (ev->event_number() < 5) {
+      REQUIRE_THROWS_AS(swc.calc_weight(*ev), SplineWeightCalcUnknownEvent);
+    } else {
+      REQUIRE_THAT(swc.calc_weight(*ev), WithinRel(wc->calc_weight(*ev), 1E-5));
+    }
+  }
+}
@@ -0,0 +1,47 @@
+import pytest
+
+import numpy as np
+import pyNUISANCE as nuis
+
+@pytest.fixture
+def nuwro_frame():
+    evs = nuis.EventSource("nuwro-sample-ANL.root")
+    return nuis.EventFrameGen(evs) \
+        .add_column("evno", lambda ev: ev.event_number()) \
+        .add_int_column("evno_int", lambda ev: ev.event_number()) \
+        .typed_storage() \
+        .limit(10) \
+        .all()
+
+def test_eventframe_column_read(nuwro_frame):
+    evno = nuwro_frame["evno"]
+    assert evno.dtype == np.float64
+    assert len(evno) == 10
+
+    evno_int = nuwro_frame.evno_int
+    assert evno_int.dtype.kind == "i"
+    assert np.array_equal(evno, evno_int)
+
+def test_eventframe_column_write_in_place(nuwro_frame):
+    evno = nuwro_frame["evno"]
+    evno[0] = -123
+    assert nuwro_frame["evno"][0] == -123
+
+    evno_int = nuwro_frame["evno_int"]
+    evno_int[1] = -456
+    assert nuwro_frame.evno_int[1] == -456
+
+def test_eventframe_column_write_back(nuwro_frame):
+    nuwro_frame["evno"] = nuwro_frame["evno"] * 2
+    nuwro_frame["evno_int"] = nuwro_frame["evno_int"] * 2
+    assert np.array_equal(nuwro_frame["evno"], nuwro_frame["evno_int"])
+
+def test_eventframe_column_outlives_frame():
+    evs = nuis.EventSource("nuwro-sample-ANL.root")
+    evno = nuis.EventFrameGen(evs) \
+        .add_column("evno", lambda ev: ev.event_number()) \
+        .limit(10) \
+        .all()["evno"]
+    assert len(evno) == 10
+    evno[0] = 1
+    assert evno[0] == 1